@@ -7,6 +7,10 @@
 #include <linux/gpio/consumer.h>    // For the modern GPIO descriptor API: devm_gpiod_get(), gpiod_to_irq(), gpiod_get_value()
 #include <linux/interrupt.h>        // For interrupt handling: irqreturn_t, devm_request_irq(), IRQF_TRIGGER_FALLING, IRQ_HANDLED
 #include <linux/platform_device.h>  // For platform driver support: platform_device, platform_driver, .probe, .remove
+#include <linux/notifier.h>         // For the atomic notifier chain that publishes button edges
+#include <linux/timekeeping.h>      // For ktime_get_ns() event timestamps
+
+#include "gpio_ctrl.h"              // Shared event record and notifier declarations
 
 
 // GPIO descriptor for the button
@@ -21,13 +25,43 @@ static const char *button_label = "gpio-button";
 // External LED toggle function provided by the LED driver
 extern void gpio_led_toggle(void);
 
+// Subscribers notified on every button edge (e.g. the gpio_ctrl event queue)
+static ATOMIC_NOTIFIER_HEAD(button_notifier_list);
+
+/**
+ * register_button_notifier - Subscribe to button edge events
+ * @nb: Notifier block; its callback receives a struct gpio_event as data
+ *
+ * The callback is invoked from button_isr in hard IRQ context and must not sleep.
+ *
+ * Return: 0 on success, negative error code on failure.
+ */
+int register_button_notifier(struct notifier_block *nb)
+{
+    return atomic_notifier_chain_register(&button_notifier_list, nb);
+}
+EXPORT_SYMBOL(register_button_notifier);
+
+/**
+ * unregister_button_notifier - Remove a button edge subscriber
+ * @nb: Notifier block previously passed to register_button_notifier()
+ *
+ * Return: 0 on success, -ENOENT if @nb was not registered.
+ */
+int unregister_button_notifier(struct notifier_block *nb)
+{
+    return atomic_notifier_chain_unregister(&button_notifier_list, nb);
+}
+EXPORT_SYMBOL(unregister_button_notifier);
+
 /**
  * button_isr - Interrupt handler for the GPIO button
  * @irq: IRQ number triggered
  * @dev_id: Pointer to the platform device
  *
  * This function is executed when the button is pressed
- * (IRQ triggered on falling edge). It toggles the LED.
+ * (IRQ triggered on falling edge). It toggles the LED and publishes
+ * the edge to the button notifier chain.
  *
  * Return: IRQ_HANDLED after successful handling.
  */
@@ -35,9 +69,15 @@ static irqreturn_t button_isr(int irq, void *dev_id)
 {
     struct platform_device *pdev = dev_id;
     struct device *dev = &pdev->dev;
+    struct gpio_event event = {
+        .type = GPIO_EVENT_BUTTON,
+        .timestamp_ns = ktime_get_ns(),
+        .value = gpiod_get_value(button_desc),
+    };
 
     dev_info(dev, "Interrupt triggered on IRQ %d (button: '%s')\n", irq, button_label);
     gpio_led_toggle();  // Toggle the LED state
+    atomic_notifier_call_chain(&button_notifier_list, 0, &event);
     return IRQ_HANDLED;
 }
 
@@ -0,0 +1,180 @@
+#ifndef GPIO_CTRL_H
+#define GPIO_CTRL_H
+
+#include <linux/types.h>        // Fixed-width types shared with user space: __u32, __u64
+#include <linux/ioctl.h>        // IOCTL macros and definitions
+#include <linux/filter.h>       // Classic BPF program layout: struct sock_fprog
+
+/*
+ * Event types reported through /dev/gpio_ctrl*
+ */
+#define GPIO_EVENT_BUTTON  1    // Button edge seen by button_isr
+#define GPIO_EVENT_LED     2    // LED toggled through the write() interface
+#define GPIO_EVENT_INPUT   3    // Edge on a configfs-provisioned input line
+#define GPIO_EVENT_OUTPUT  4    // Configfs-provisioned output line toggled
+
+/**
+ * struct gpio_event - One event record queued to /dev/gpio_ctrl readers
+ * @type: GPIO_EVENT_* type of the event
+ * @value: Logical line value sampled when the event was taken
+ * @timestamp_ns: CLOCK_MONOTONIC time of the event in nanoseconds
+ * @seq: Sequence number assigned when the event is queued
+ *
+ * This is also the context a filter program sees: 32-bit loads at
+ * offsets 0 (type), 4 (value), 8 and 12 (timestamp, low word first on
+ * little-endian). @seq is not assigned yet when the filter runs.
+ */
+struct gpio_event {
+    __u32 type;
+    __u32 value;
+    __u64 timestamp_ns;
+    __u64 seq;
+};
+
+/**
+ * struct gpio_event_hook - Context of the gpio_ctrl_queue_event raw tracepoint
+ * @event: Event about to be queued; an attached program may rewrite it
+ *         (@event.seq is assigned afterwards and ignored)
+ * @minor: Minor number of the /dev/gpio_ctrl* device queueing the event
+ * @drop: Set to non-zero by a program to drop the event
+ *
+ * The tracepoint is writable: BPF_PROG_TYPE_RAW_TRACEPOINT_WRITABLE
+ * programs may store anywhere in this structure and use maps to
+ * aggregate events. It runs before the GPIO_SET_FILTER filter.
+ */
+struct gpio_event_hook {
+    struct gpio_event event;
+    __u32 minor;
+    __u32 drop;
+};
+
+/**
+ * struct gpio_wakeup - Poll wakeup batching for one open file
+ * @low_watermark: Pending events required before poll reports POLLIN (>= 1)
+ * @max_delay_us: Maximum time the oldest pending event may wait for the
+ *                watermark before poll reports POLLIN anyway (0 = no limit)
+ *
+ * The same rule drives GPIO_SET_EVENTFD and SIGIO: a notification is sent
+ * for every event queued while @low_watermark or more events are pending,
+ * and when the oldest pending event has waited @max_delay_us. Events left
+ * behind by a partial read are reported again @max_delay_us later, so
+ * readers need not drain to -EAGAIN. Nothing is sent once the queue is empty.
+ */
+struct gpio_wakeup {
+    __u32 low_watermark;
+    __u32 max_delay_us;
+};
+
+/*
+ * Operations accepted by GPIO_BATCH
+ */
+#define GPIO_OP_GET_STATUS 0    // result = status word, as GPIO_GET_STATUS
+#define GPIO_OP_TOGGLE_LED 1    // result = 0
+#define GPIO_OP_READ_EVENT 2    // result = 0 and @event filled, or -EAGAIN
+#define GPIO_OP_WAIT_EVENT 3    // Block for the next event: result = 0 and @event filled,
+                                // -ETIMEDOUT, or -EINTR (stops the batch)
+
+/**
+ * struct gpio_op - One operation in a GPIO_BATCH vector
+ * @opcode: GPIO_OP_* operation to run
+ * @result: Output: operation result, or a negative error code
+ * @event: Output: dequeued event for GPIO_OP_READ_EVENT and GPIO_OP_WAIT_EVENT.
+ *         For GPIO_OP_WAIT_EVENT, @event.timestamp_ns is also an input: the
+ *         absolute CLOCK_MONOTONIC deadline, 0 = wait forever
+ */
+struct gpio_op {
+    __u32 opcode;
+    __s32 result;
+    struct gpio_event event;
+};
+
+/**
+ * struct gpio_batch - Vector of operations executed by one GPIO_BATCH call
+ * @ops: User pointer to an array of struct gpio_op
+ * @count: Number of entries in @ops
+ * @completed: Output: number of entries executed and written back
+ */
+struct gpio_batch {
+    __u64 ops;
+    __u32 count;
+    __u32 completed;
+};
+
+/**
+ * struct gpio_wait_event - Blocking wait for one event plus a status snapshot
+ * @after_seq: In: return the first event with a sequence number greater than
+ *             this, or GPIO_WAIT_NEXT for the first event queued after the call
+ * @deadline_ns: In: absolute CLOCK_MONOTONIC deadline, 0 = wait forever
+ * @event: Out: the event; a gap in @seq means older events were overwritten
+ * @status: Out: GPIO_GET_STATUS word sampled when the call returns
+ * @reserved: Must be zero (-EINVAL otherwise)
+ *
+ * Waiting does not move the caller's GPIO_READ_EVENT cursor; pass
+ * @event.seq back as @after_seq to walk the event stream.
+ */
+struct gpio_wait_event {
+    __u64 after_seq;
+    __u64 deadline_ns;
+    struct gpio_event event;
+    __s32 status;
+    __u32 reserved;
+};
+
+#define GPIO_WAIT_NEXT    (~(__u64)0)
+
+#define GPIO_CTRL_MAGIC   'G'
+#define GPIO_GET_STATUS   _IOR(GPIO_CTRL_MAGIC, 0, int)                 // Read LED & Button status
+#define GPIO_TOGGLE_LED   _IO(GPIO_CTRL_MAGIC, 1)                       // Toggle LED command
+#define GPIO_READ_EVENT   _IOR(GPIO_CTRL_MAGIC, 2, struct gpio_event)   // Dequeue next pending event
+#define GPIO_SET_FILTER   _IOW(GPIO_CTRL_MAGIC, 3, struct sock_fprog)   // Attach classic BPF event filter
+#define GPIO_CLEAR_FILTER _IO(GPIO_CTRL_MAGIC, 4)                       // Detach event filter
+#define GPIO_SET_WAKEUP   _IOW(GPIO_CTRL_MAGIC, 5, struct gpio_wakeup)  // Set poll wakeup batching
+#define GPIO_SET_EVENTFD  _IOW(GPIO_CTRL_MAGIC, 6, int)                 // Register eventfd (-1 = none)
+#define GPIO_BATCH        _IOWR(GPIO_CTRL_MAGIC, 7, struct gpio_batch)  // Run a vector of operations
+#define GPIO_WAIT_EVENT   _IOWR(GPIO_CTRL_MAGIC, 8, struct gpio_wait_event)  // Wait for event + status
+
+/**
+ * struct gpio_sample_run - One run-length-encoded sample of the sampler lines
+ * @values: Line values, bit N = Nth line of the sampler's gpios property
+ * @ticks: Number of consecutive sample periods the lines held @values
+ */
+struct gpio_sample_run {
+    __u32 values;
+    __u32 ticks;
+};
+
+/**
+ * struct gpio_sampler_status - State of the logic-analyzer sampler
+ * @num_lines: Number of lines sampled per tick
+ * @running: Non-zero while the sampling timer is active
+ * @num_runs: Runs stored so far; readable through read() or mmap()
+ * @max_runs: Capacity of the capture buffer in runs
+ * @period_ns: Sample period of the current or last capture
+ * @missed_ticks: Periods the timer could not service in time (counted
+ *                as unchanged samples)
+ * @total_ticks: Sample periods covered by the capture so far
+ */
+struct gpio_sampler_status {
+    __u32 num_lines;
+    __u32 running;
+    __u32 num_runs;
+    __u32 max_runs;
+    __u32 period_ns;
+    __u32 missed_ticks;
+    __u64 total_ticks;
+};
+
+#define GPIO_SAMPLER_START  _IOW(GPIO_CTRL_MAGIC, 16, __u32)                       // Start capture, arg = period in ns
+#define GPIO_SAMPLER_STOP   _IO(GPIO_CTRL_MAGIC, 17)                               // Stop capture, flush last run
+#define GPIO_SAMPLER_STATUS _IOR(GPIO_CTRL_MAGIC, 18, struct gpio_sampler_status)  // Read sampler state
+
+#ifdef __KERNEL__
+#include <linux/notifier.h>     // Notifier chain used to publish button edges
+
+// Button edge notifications, provided by the button driver.
+// Callbacks run in hard IRQ context with a struct gpio_event as data.
+extern int register_button_notifier(struct notifier_block *nb);
+extern int unregister_button_notifier(struct notifier_block *nb);
+#endif
+
+#endif /* GPIO_CTRL_H */
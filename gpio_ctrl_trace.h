@@ -0,0 +1,32 @@
+/*
+ * Tracepoints of the GPIO control device
+ *
+ * gpio_ctrl_queue_event is a writable raw tracepoint: a
+ * BPF_PROG_TYPE_RAW_TRACEPOINT_WRITABLE program attached to it receives
+ * the struct gpio_event_hook as its first argument and may rewrite the
+ * event, set @drop, and aggregate into maps before the event is queued.
+ */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM gpio_ctrl
+
+#if !defined(_GPIO_CTRL_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _GPIO_CTRL_TRACE_H
+
+#include <linux/tracepoint.h>   // DECLARE_TRACE_WRITABLE
+
+#include "gpio_ctrl.h"          // struct gpio_event_hook
+
+DECLARE_TRACE_WRITABLE(gpio_ctrl_queue_event,
+    TP_PROTO(struct gpio_event_hook *hook),
+    TP_ARGS(hook),
+    sizeof(struct gpio_event_hook)
+);
+
+#endif /* _GPIO_CTRL_TRACE_H */
+
+// Out-of-tree module: the trace header lives next to ioctl.c
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE gpio_ctrl_trace
+#include <trace/define_trace.h>
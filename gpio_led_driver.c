@@ -24,12 +24,24 @@ int get_led_status(void)
 EXPORT_SYMBOL(get_led_status);  // Export this function to be used by other modules
 
 /**
- * gpio_led_toggle - Toggle the LED GPIO and update internal state
+ * gpio_led_toggle_quiet - Toggle the LED GPIO without logging
+ *
+ * For high-rate callers such as GPIO_BATCH, where a log line per toggle
+ * would flood the console.
  */
-void gpio_led_toggle(void)
+void gpio_led_toggle_quiet(void)
 {
     led_state = !led_state;                      // Flip the LED state
     gpiod_set_value(led_desc, led_state);        // Apply new value to the GPIO pin
+}
+EXPORT_SYMBOL(gpio_led_toggle_quiet);
+
+/**
+ * gpio_led_toggle - Toggle the LED GPIO and update internal state
+ */
+void gpio_led_toggle(void)
+{
+    gpio_led_toggle_quiet();
     pr_info("gpio-led: LED toggled to %s\n", led_state ? "ON" : "OFF");
 }
 EXPORT_SYMBOL(gpio_led_toggle);  // Export to allow other drivers to call this
@@ -0,0 +1,675 @@
+#include <linux/module.h>           // For module macros: MODULE_LICENSE, MODULE_AUTHOR, MODULE_DESCRIPTION
+#include <linux/of.h>               // For reading properties from the Device Tree: of_property_read_u32()
+#include <linux/of_platform.h>      // For finding the drivers owning shared lines: of_find_device_by_node()
+#include <linux/gpio/consumer.h>    // For the GPIO descriptor API: gpiod_get_index(), gpiod_get_array_value()
+#include <linux/platform_device.h>  // For platform driver support: platform_device, platform_driver, .probe, .remove
+#include <linux/hrtimer.h>          // For the fixed-rate sampling timer
+#include <linux/fs.h>               // For file operations: open, read, mmap, ioctl
+#include <linux/cdev.h>             // For the character device structure
+#include <linux/device.h>           // For device creation: class, device_create
+#include <linux/uaccess.h>          // For copy_to_user / copy_from_user
+#include <linux/vmalloc.h>          // For the capture buffer: vmalloc_user(), remap_vmalloc_range()
+#include <linux/mutex.h>            // For serializing start/stop/status
+#include <linux/slab.h>             // For the descriptor array: kcalloc, kfree
+#include <linux/kref.h>             // For keeping the capture alive while files are open
+
+#include "gpio_ctrl.h"              // Shared sampler IOCTLs and run record
+
+#define DEVICE_NAME "gpio_sampler"
+#define CLASS_NAME  "gpio_sampler_class"
+
+#define SAMPLER_MAX_LINES        32             // One bit per line in struct gpio_sample_run
+#define SAMPLER_DEFAULT_BUFSIZE  (1024 * 1024)  // Capture buffer size if DT has no "buffer-size"
+#define SAMPLER_MIN_PERIOD_NS    10000          // Fastest sample rate accepted (100 kHz)
+
+// Sampled lines, in the order of the DT gpios property
+static struct gpio_desc **sample_descs;
+static unsigned int num_lines;
+static unsigned long shared_lines;      // Lines owned by another driver, not released by us
+
+/**
+ * struct sampler_capture - Capture buffer shared by the device and its open files
+ * @ref: One reference for the bound device plus one per open file
+ * @dead: Set under sampler_mutex when the device is removed
+ * @runs: Run records, preallocated at probe and mapped read-only to user space
+ * @max_runs: Capacity of @runs
+ * @buffer_size: Size of @runs in bytes
+ * @num_runs: Published runs; written by the timer, read locklessly
+ *
+ * Open files keep the capture alive after the device is unbound, so
+ * late readers get -ENODEV instead of touching freed memory.
+ */
+struct sampler_capture {
+    struct kref ref;
+    bool dead;
+    struct gpio_sample_run *runs;
+    u32 max_runs;
+    size_t buffer_size;
+    u32 num_runs;
+};
+
+static struct sampler_capture *capture; // Capture of the bound device, NULL when removed
+
+// Sampling state, only touched by the timer callback while it is running
+static struct hrtimer sample_timer;
+static ktime_t sample_period;
+static u32 cur_values;
+static u32 cur_ticks;
+static u32 missed_ticks;
+static u64 total_ticks;
+static bool sampling;
+
+static DEFINE_MUTEX(sampler_mutex);    // Serializes start/stop/status/open, probe and removal
+
+// All state above is module-wide, so only one sampler device may be bound
+static struct platform_device *sampler_pdev;
+
+static dev_t dev_num;                   // Allocated at module init
+static struct class *sampler_class;     // Created at module init
+static struct cdev *sampler_cdev;       // Per bound device; freed once open files let go
+static struct device *sampler_device;
+
+/**
+ * sampler_emit_run - Append the current run to the capture buffer
+ *
+ * Return: false if the buffer is full.
+ */
+static bool sampler_emit_run(void)
+{
+    u32 n = capture->num_runs;
+
+    if (n >= capture->max_runs)
+        return false;
+
+    capture->runs[n].values = cur_values;
+    capture->runs[n].ticks = cur_ticks;
+    smp_wmb();                          // Publish the record before the count
+    WRITE_ONCE(capture->num_runs, n + 1);
+    return true;
+}
+
+/**
+ * sampler_tick - Sampling timer callback
+ * @timer: The sampling hrtimer
+ *
+ * Reads all lines with a single bulk gpiod_get_array_value() and only
+ * stores a record when the values change. Stops the capture once the
+ * buffer is full or the lines cannot be read.
+ *
+ * Return: HRTIMER_RESTART while sampling, HRTIMER_NORESTART otherwise.
+ */
+static enum hrtimer_restart sampler_tick(struct hrtimer *timer)
+{
+    unsigned long bits[BITS_TO_LONGS(SAMPLER_MAX_LINES)] = { 0 };
+    u64 overruns;
+    u32 values;
+
+    if (gpiod_get_array_value(num_lines, sample_descs, NULL, bits)) {
+        sampling = false;
+        return HRTIMER_NORESTART;
+    }
+    values = (u32)bits[0];
+
+    if (cur_ticks && (values != cur_values || cur_ticks == U32_MAX)) {
+        if (!sampler_emit_run()) {
+            sampling = false;
+            return HRTIMER_NORESTART;
+        }
+        cur_ticks = 0;
+    }
+    cur_values = values;
+    cur_ticks++;
+    total_ticks++;
+
+    // Periods we were too late for are accounted to the current run
+    overruns = hrtimer_forward_now(timer, sample_period);
+    if (overruns > 1) {
+        missed_ticks += overruns - 1;
+        total_ticks += overruns - 1;
+        cur_ticks = min_t(u64, (u64)cur_ticks + overruns - 1, U32_MAX);
+    }
+
+    return HRTIMER_RESTART;
+}
+
+/**
+ * sampler_stop - Stop the capture and flush the last run
+ *
+ * Caller holds sampler_mutex.
+ */
+static void sampler_stop(void)
+{
+    hrtimer_cancel(&sample_timer);
+    if (cur_ticks) {
+        sampler_emit_run();
+        cur_ticks = 0;
+    }
+    sampling = false;
+}
+
+/**
+ * sampler_capture_free - Release the capture once the last reference is gone
+ * @ref: The capture's reference count
+ */
+static void sampler_capture_free(struct kref *ref)
+{
+    struct sampler_capture *cap = container_of(ref, struct sampler_capture, ref);
+
+    vfree(cap->runs);
+    kfree(cap);
+}
+
+/**
+ * sampler_open - Pin the current capture for this file
+ * @inode: Inode of the device node
+ * @file: File pointer
+ *
+ * Return: 0 on success, -ENODEV if the device was removed.
+ */
+static int sampler_open(struct inode *inode, struct file *file)
+{
+    int ret = 0;
+
+    mutex_lock(&sampler_mutex);
+    if (capture) {
+        kref_get(&capture->ref);
+        file->private_data = capture;
+    } else {
+        ret = -ENODEV;
+    }
+    mutex_unlock(&sampler_mutex);
+
+    return ret;
+}
+
+/**
+ * sampler_release - Drop the file's capture reference
+ * @inode: Inode of the device node
+ * @file: File pointer
+ *
+ * Existing mappings hold their own page references and stay valid.
+ *
+ * Return: 0
+ */
+static int sampler_release(struct inode *inode, struct file *file)
+{
+    struct sampler_capture *cap = file->private_data;
+
+    kref_put(&cap->ref, sampler_capture_free);
+    return 0;
+}
+
+/**
+ * sampler_read - Copy captured runs to user space
+ * @file: File pointer
+ * @buf: User-space buffer
+ * @count: Number of bytes requested
+ * @ppos: Byte offset into the capture buffer
+ *
+ * Returns the struct gpio_sample_run records stored so far. The run in
+ * progress only appears once the lines change or the capture stops.
+ *
+ * Return: Number of bytes read, 0 at the end of the captured data, -ENODEV
+ * after the device was removed, or -EFAULT.
+ */
+static ssize_t sampler_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+    struct sampler_capture *cap = file->private_data;
+    size_t avail;
+
+    if (READ_ONCE(cap->dead))
+        return -ENODEV;
+
+    avail = (size_t)READ_ONCE(cap->num_runs) * sizeof(*cap->runs);
+    smp_rmb();                          // Pairs with sampler_emit_run()
+    if (*ppos >= avail)
+        return 0;
+
+    count = min_t(size_t, count, avail - *ppos);
+    if (copy_to_user(buf, (char *)cap->runs + *ppos, count))
+        return -EFAULT;
+
+    *ppos += count;
+    return count;
+}
+
+/**
+ * sampler_mmap - Map the capture buffer read-only into user space
+ * @file: File pointer
+ * @vma: Mapping requested by user space
+ *
+ * Return: 0 on success, -ENODEV after the device was removed, -EPERM for
+ * writable mappings, or an error from remap_vmalloc_range().
+ */
+static int sampler_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct sampler_capture *cap = file->private_data;
+
+    if (READ_ONCE(cap->dead))
+        return -ENODEV;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+    vma->vm_flags &= ~VM_MAYWRITE;
+
+    return remap_vmalloc_range(vma, cap->runs, vma->vm_pgoff);
+}
+
+/**
+ * sampler_ioctl - Handle sampler IOCTL commands
+ * @file: File pointer
+ * @cmd: IOCTL command
+ * @arg: Argument from user space
+ *
+ * Supported commands:
+ * - GPIO_SAMPLER_START: Clear the buffer and sample every @arg nanoseconds
+ * - GPIO_SAMPLER_STOP: Stop sampling and flush the run in progress
+ * - GPIO_SAMPLER_STATUS: Return a struct gpio_sampler_status
+ *
+ * Return: 0 on success, -ENODEV after the device was removed, or another
+ * negative error code on failure.
+ */
+static long sampler_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    struct sampler_capture *cap = file->private_data;
+    long ret = 0;
+
+    mutex_lock(&sampler_mutex);
+
+    if (cap->dead) {
+        mutex_unlock(&sampler_mutex);
+        return -ENODEV;
+    }
+
+    switch (cmd) {
+    case GPIO_SAMPLER_START: {
+        u32 period_ns;
+
+        if (copy_from_user(&period_ns, (u32 __user *)arg, sizeof(period_ns))) {
+            ret = -EFAULT;
+            break;
+        }
+        if (period_ns < SAMPLER_MIN_PERIOD_NS) {
+            ret = -EINVAL;
+            break;
+        }
+
+        sampler_stop();                 // Restarting discards the previous capture
+        WRITE_ONCE(cap->num_runs, 0);
+        cur_values = 0;
+        missed_ticks = 0;
+        total_ticks = 0;
+        sample_period = ns_to_ktime(period_ns);
+        sampling = true;
+        hrtimer_start(&sample_timer, sample_period, HRTIMER_MODE_REL);
+        pr_info("gpio-sampler: sampling %u lines every %u ns\n", num_lines, period_ns);
+        break;
+    }
+    case GPIO_SAMPLER_STOP:
+        sampler_stop();
+        pr_info("gpio-sampler: stopped with %u runs\n", cap->num_runs);
+        break;
+    case GPIO_SAMPLER_STATUS: {
+        struct gpio_sampler_status status = {
+            .num_lines = num_lines,
+            .running = READ_ONCE(sampling),
+            .num_runs = READ_ONCE(cap->num_runs),
+            .max_runs = cap->max_runs,
+            .period_ns = ktime_to_ns(sample_period),
+            .missed_ticks = READ_ONCE(missed_ticks),
+            .total_ticks = READ_ONCE(total_ticks),
+        };
+
+        if (copy_to_user((void __user *)arg, &status, sizeof(status)))
+            ret = -EFAULT;
+        break;
+    }
+    default:
+        ret = -EINVAL;
+        break;
+    }
+
+    mutex_unlock(&sampler_mutex);
+    return ret;
+}
+
+// File operations for /dev/gpio_sampler
+static const struct file_operations sampler_fops = {
+    .owner          = THIS_MODULE,
+    .open           = sampler_open,
+    .release        = sampler_release,
+    .read           = sampler_read,
+    .mmap           = sampler_mmap,
+    .unlocked_ioctl = sampler_ioctl,
+    .llseek         = default_llseek,
+};
+
+/**
+ * sampler_put_lines - Release the lines this driver requested itself
+ */
+static void sampler_put_lines(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < num_lines; i++)
+        if (!test_bit(i, &shared_lines))
+            gpiod_put(sample_descs[i]);
+    kfree(sample_descs);
+    sample_descs = NULL;
+    shared_lines = 0;
+    num_lines = 0;
+}
+
+/**
+ * sampler_link_owner - Tie the sampler to the driver owning a shared line
+ * @dev: Sampler device
+ * @index: Line index in the gpios property
+ *
+ * The "wings,line-owners" property lists, per line, the DT node of the
+ * device whose driver owns it (0 if the sampler owns the line itself).
+ * For an owned line the sampler defers until that driver is bound, so it
+ * can never request the line first, and adds a managed device link so
+ * unbinding the owner unbinds the sampler before the line goes away.
+ *
+ * Return: 1 if the line is owned by another driver, 0 if not,
+ * -EPROBE_DEFER while the owner is not bound, or a negative error code.
+ */
+static int sampler_link_owner(struct device *dev, int index)
+{
+    struct platform_device *owner;
+    struct device_node *np;
+    int ret = 1;
+
+    np = of_parse_phandle(dev->of_node, "wings,line-owners", index);
+    if (!np)
+        return 0;
+
+    owner = of_find_device_by_node(np);
+    of_node_put(np);
+    if (!owner)
+        return -EPROBE_DEFER;
+
+    // dev.driver is already set while the owner probes; wait for the bind to complete
+    if (READ_ONCE(owner->dev.links.status) != DL_DEV_DRIVER_BOUND) {
+        ret = -EPROBE_DEFER;
+    } else if (!device_link_add(dev, &owner->dev, DL_FLAG_AUTOREMOVE_CONSUMER)) {
+        dev_err(dev, "Failed to link sampler GPIO %d to its owner\n", index);
+        ret = -EINVAL;
+    }
+
+    put_device(&owner->dev);
+    return ret;
+}
+
+/**
+ * sampler_get_lines - Look up the lines listed in the DT gpios property
+ * @dev: Sampler device
+ *
+ * Lines are requested as-is so their direction is left alone. Lines
+ * owned by another driver (e.g. the LED and button, see
+ * sampler_link_owner()) are borrowed non-exclusively and not released on
+ * remove; the sampler refuses to become the owner of such a line. All
+ * lines must be readable from the timer, i.e. on a non-sleeping GPIO
+ * controller.
+ *
+ * Return: 0 on success, negative error code on failure.
+ */
+static int sampler_get_lines(struct device *dev)
+{
+    struct gpio_desc *desc;
+    int count, i, owned;
+
+    count = gpiod_count(dev, NULL);
+    if (count <= 0 || count > SAMPLER_MAX_LINES) {
+        dev_err(dev, "Expected 1..%d sampler GPIOs\n", SAMPLER_MAX_LINES);
+        return count < 0 ? count : -EINVAL;
+    }
+
+    sample_descs = kcalloc(count, sizeof(*sample_descs), GFP_KERNEL);
+    if (!sample_descs)
+        return -ENOMEM;
+
+    for (i = 0; i < count; i++) {
+        owned = sampler_link_owner(dev, i);
+        if (owned < 0) {
+            sampler_put_lines();
+            return owned;
+        }
+
+        desc = gpiod_get_index(dev, NULL, i, GPIOD_ASIS);
+        if (owned && !IS_ERR(desc)) {
+            // The owner is bound but does not hold the line: do not take it over
+            dev_err(dev, "Sampler GPIO %d is not held by its owner\n", i);
+            gpiod_put(desc);
+            sampler_put_lines();
+            return -EINVAL;
+        }
+        if (owned && PTR_ERR(desc) == -EBUSY) {
+            desc = gpiod_get_index(dev, NULL, i, GPIOD_ASIS | GPIOD_FLAGS_BIT_NONEXCLUSIVE);
+            if (!IS_ERR(desc))
+                set_bit(i, &shared_lines);
+        }
+        if (IS_ERR(desc)) {
+            if (PTR_ERR(desc) != -EPROBE_DEFER)
+                dev_err(dev, "Failed to get sampler GPIO %d\n", i);
+            sampler_put_lines();
+            return PTR_ERR(desc);
+        }
+
+        sample_descs[i] = desc;
+        num_lines = i + 1;
+
+        if (gpiod_cansleep(desc)) {
+            dev_err(dev, "Sampler GPIO %d is on a sleeping controller\n", i);
+            sampler_put_lines();
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * sampler_probe - Called when the device is matched and initialized
+ * @pdev: Pointer to the platform device structure
+ *
+ * Tasks:
+ * - Refuse a second sampler device, as the sampler state is module-wide
+ * - Wait for the drivers owning shared lines and link to them
+ * - Request the sampled lines from the Device Tree
+ * - Preallocate the capture buffer ("buffer-size" property, bytes)
+ * - Register the /dev/gpio_sampler character device
+ *
+ * Return: 0 on success, -EBUSY if another sampler is bound, negative
+ * error code on other failures
+ */
+static int sampler_probe(struct platform_device *pdev)
+{
+    struct device *dev = &pdev->dev;
+    struct sampler_capture *cap;
+    u32 size = SAMPLER_DEFAULT_BUFSIZE;
+    int ret;
+
+    mutex_lock(&sampler_mutex);
+    if (sampler_pdev) {
+        mutex_unlock(&sampler_mutex);
+        dev_err(dev, "Only one sampler is supported, %s is already bound\n",
+                dev_name(&sampler_pdev->dev));
+        return -EBUSY;
+    }
+    sampler_pdev = pdev;
+    mutex_unlock(&sampler_mutex);
+
+    ret = sampler_get_lines(dev);
+    if (ret)
+        goto err_claim;
+
+    cap = kzalloc(sizeof(*cap), GFP_KERNEL);
+    if (!cap) {
+        ret = -ENOMEM;
+        goto err_lines;
+    }
+    kref_init(&cap->ref);
+
+    of_property_read_u32(dev->of_node, "buffer-size", &size);
+    cap->buffer_size = PAGE_ALIGN(size);
+    cap->max_runs = cap->buffer_size / sizeof(*cap->runs);
+
+    cap->runs = vmalloc_user(cap->buffer_size);
+    if (!cap->runs) {
+        ret = -ENOMEM;
+        goto err_buffer;
+    }
+
+    hrtimer_init(&sample_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+    sample_timer.function = sampler_tick;
+
+    mutex_lock(&sampler_mutex);
+    capture = cap;
+    mutex_unlock(&sampler_mutex);
+
+    sampler_cdev = cdev_alloc();
+    if (!sampler_cdev) {
+        ret = -ENOMEM;
+        goto err_capture;
+    }
+    sampler_cdev->ops = &sampler_fops;
+    sampler_cdev->owner = THIS_MODULE;
+
+    ret = cdev_add(sampler_cdev, dev_num, 1);
+    if (ret) {
+        dev_err(dev, "Failed to add cdev\n");
+        kobject_put(&sampler_cdev->kobj);
+        goto err_capture;
+    }
+
+    sampler_device = device_create(sampler_class, dev, dev_num, NULL, DEVICE_NAME);
+    if (IS_ERR(sampler_device)) {
+        dev_err(dev, "Failed to create device\n");
+        ret = PTR_ERR(sampler_device);
+        goto err_cdev;
+    }
+
+    dev_info(dev, "Sampling %u lines into %zu KiB buffer\n", num_lines, cap->buffer_size / 1024);
+    return 0;
+
+err_cdev:
+    cdev_del(sampler_cdev);
+err_capture:
+    mutex_lock(&sampler_mutex);
+    cap->dead = true;                   // A racing open may still hold a reference
+    capture = NULL;
+    mutex_unlock(&sampler_mutex);
+err_buffer:
+    kref_put(&cap->ref, sampler_capture_free);
+err_lines:
+    sampler_put_lines();
+err_claim:
+    mutex_lock(&sampler_mutex);
+    sampler_pdev = NULL;
+    mutex_unlock(&sampler_mutex);
+    return ret;
+}
+
+/**
+ * sampler_remove - Called when the device is removed
+ * @pdev: Pointer to the platform device structure
+ *
+ * Stops the capture and marks it dead so files still open fail with
+ * -ENODEV; the buffer itself is freed when the last of them is closed.
+ *
+ * Return: 0
+ */
+static int sampler_remove(struct platform_device *pdev)
+{
+    struct sampler_capture *cap;
+
+    mutex_lock(&sampler_mutex);
+    sampler_stop();
+    cap = capture;
+    cap->dead = true;
+    capture = NULL;
+    sampler_put_lines();
+    mutex_unlock(&sampler_mutex);
+
+    device_destroy(sampler_class, dev_num);
+    cdev_del(sampler_cdev);
+    kref_put(&cap->ref, sampler_capture_free);
+
+    mutex_lock(&sampler_mutex);
+    sampler_pdev = NULL;
+    mutex_unlock(&sampler_mutex);
+
+    pr_info("gpio-sampler: Device removed\n");
+    return 0;
+}
+
+// Device Tree match table for compatible strings
+static const struct of_device_id sampler_of_match[] = {
+    { .compatible = "wings,gpio-sampler", },
+    { },
+};
+MODULE_DEVICE_TABLE(of, sampler_of_match);
+
+// Platform driver structure
+static struct platform_driver sampler_driver = {
+    .probe = sampler_probe,
+    .remove = sampler_remove,
+    .driver = {
+        .name = "gpio_sampler_driver",
+        .of_match_table = sampler_of_match,
+    },
+};
+
+/**
+ * sampler_init - Module initialization function
+ *
+ * Allocates the device number and class used by the sampler device,
+ * then registers the platform driver.
+ *
+ * Return: 0 on success, or negative error code on failure.
+ */
+static int __init sampler_init(void)
+{
+    int ret;
+
+    ret = alloc_chrdev_region(&dev_num, 0, 1, DEVICE_NAME);
+    if (ret) {
+        pr_err("gpio-sampler: Failed to allocate chrdev region\n");
+        return ret;
+    }
+
+    sampler_class = class_create(THIS_MODULE, CLASS_NAME);
+    if (IS_ERR(sampler_class)) {
+        pr_err("gpio-sampler: Failed to create class\n");
+        unregister_chrdev_region(dev_num, 1);
+        return PTR_ERR(sampler_class);
+    }
+
+    // Register the driver with the platform bus
+    ret = platform_driver_register(&sampler_driver);
+    if (ret) {
+        class_destroy(sampler_class);
+        unregister_chrdev_region(dev_num, 1);
+    }
+    return ret;
+}
+
+/**
+ * sampler_exit - Module exit function
+ *
+ * Unregisters the platform driver, which removes a bound sampler, then
+ * releases the class and device number.
+ */
+static void __exit sampler_exit(void)
+{
+    platform_driver_unregister(&sampler_driver);
+    class_destroy(sampler_class);
+    unregister_chrdev_region(dev_num, 1);
+}
+
+module_init(sampler_init);
+module_exit(sampler_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Wings Mon");
+MODULE_DESCRIPTION("Logic-analyzer style GPIO sampler with run-length-encoded capture");
@@ -6,40 +6,657 @@
 #include <linux/poll.h>         // Support for poll/select system calls
 #include <linux/mutex.h>        // Kernel mutex support
 #include <linux/ioctl.h>        // IOCTL macros and definitions
+#include <linux/slab.h>         // Per-file state allocation: kzalloc, kfree
+#include <linux/spinlock.h>     // Event ring lock shared with IRQ context
+#include <linux/notifier.h>     // Button edge notifications
+#include <linux/filter.h>       // Classic BPF event filters: bpf_prog_create_from_user
+#include <linux/capability.h>   // capable() check for filter attach
+#include <linux/timekeeping.h>  // ktime_get_ns() event timestamps
+#include <linux/hrtimer.h>      // Per-reader coalescing delay timer
+#include <linux/list.h>         // List of open readers
+#include <linux/eventfd.h>      // eventfd notification: eventfd_ctx_fdget, eventfd_signal
+#include <linux/rwsem.h>        // Guards line operations against runtime teardown
+#include <linux/idr.h>          // Minor number allocation for runtime lines
+#include <linux/configfs.h>     // Runtime line provisioning
+#include <linux/gpio/consumer.h> // Descriptor API for provisioned lines
+#include <linux/gpio/machine.h>  // Lookup tables mapping a chip label + offset to a device
+#include <linux/interrupt.h>    // Edge interrupts on provisioned input lines
+#include <linux/sched/signal.h> // fatal_signal_pending() between GPIO_BATCH chunks
+
+#include "gpio_ctrl.h"          // IOCTL numbers and event record shared with user space
+
+#define CREATE_TRACE_POINTS
+#include "gpio_ctrl_trace.h"    // Writable gpio_ctrl_queue_event tracepoint for eBPF programs
 
 #define DEVICE_NAME "gpio_ctrl"
 #define CLASS_NAME  "gpio_class"
 
-#define GPIO_CTRL_MAGIC   'G'
-#define GPIO_GET_STATUS   _IOR(GPIO_CTRL_MAGIC, 0, int)  // Read LED & Button status
-#define GPIO_TOGGLE_LED   _IO(GPIO_CTRL_MAGIC, 1)        // Toggle LED command
+#define GPIO_CTRL_MAX_MINORS 32   // Minor 0 is the LED/button device, the rest runtime lines
+#define GPIO_EVENT_RING_SIZE 256  // Events retained for readers, must be a power of two
+#define GPIO_BATCH_MAX_OPS   64   // Operations copied in per GPIO_BATCH chunk
+#define GPIO_LINE_CHIP_LEN   32   // Longest gpiochip label accepted for runtime lines
+
+struct gpio_ctrl_dev;
+
+/**
+ * struct gpio_ctrl_ops - Line operations behind one /dev/gpio_ctrl* device
+ * @get_status: Return the status word reported by GPIO_GET_STATUS, or a
+ *              negative error code if the line cannot be read
+ * @toggle: Toggle the output and return its new value, or a negative error code
+ * @batch_toggle: As @toggle, but without a log line, for GPIO_BATCH
+ * @format: Format the human-readable status returned by read(); returns its
+ *          length or a negative error code
+ * @toggle_event: GPIO_EVENT_* type queued when write("toggle") succeeds
+ */
+struct gpio_ctrl_ops {
+    int (*get_status)(struct gpio_ctrl_dev *gdev);
+    int (*toggle)(struct gpio_ctrl_dev *gdev);
+    int (*batch_toggle)(struct gpio_ctrl_dev *gdev);
+    int (*format)(struct gpio_ctrl_dev *gdev, char *buf, size_t size);
+    u32 toggle_event;
+};
+
+/**
+ * struct gpio_ctrl_dev - One /dev/gpio_ctrl* device and its event queue
+ * @dev: Device node; its release frees this structure
+ * @cdev: Character device, keeps @dev alive while files are open
+ * @ops_sem: Held for reading around @ops calls, for writing at teardown
+ * @ops: Line operations, NULL once a runtime line has been torn down
+ * @desc: Line descriptor of a runtime line (NULL for the LED/button device)
+ * @chip: Label of the gpiochip of a runtime line
+ * @offset: Offset of a runtime line within @chip
+ * @irq: Edge interrupt of a runtime input line, or 0
+ * @output: Runtime line is an output
+ * @files: Open readers, protected by @lock
+ * @event_wait: GPIO_WAIT_EVENT callers, woken on every queued event
+ * @ring: Events retained for readers; each reader keeps its own cursor
+ * @head: Sequence number of the next queued event
+ * @filter: Optional filter run before queueing
+ * @lock: Protects ring, head, filter, readers and cursors
+ */
+struct gpio_ctrl_dev {
+    struct device dev;
+    struct cdev cdev;
+    struct rw_semaphore ops_sem;
+    const struct gpio_ctrl_ops *ops;
+    struct gpio_desc *desc;
+    char chip[GPIO_LINE_CHIP_LEN];
+    unsigned int offset;
+    int irq;
+    bool output;
+    struct list_head files;
+    wait_queue_head_t event_wait;
+    struct gpio_event ring[GPIO_EVENT_RING_SIZE];
+    u64 head;
+    struct bpf_prog *filter;
+    spinlock_t lock;
+};
+
+/**
+ * struct gpio_ctrl_file - Per-open state of the GPIO control device
+ * @gdev: Device this file was opened on
+ * @node: Entry in the device's list of open readers
+ * @next_seq: Sequence number of the next event this reader will dequeue
+ * @wait: Wait queue for poll, woken once per batch
+ * @low_watermark: Pending events needed before the reader is woken
+ * @max_delay_ns: Longest time an event may wait for the watermark (0 = forever)
+ * @batch_timer: Fires when the oldest pending event reaches @max_delay_ns
+ * @notify_eventfd: eventfd signalled once per batch, or NULL
+ * @async_queue: SIGIO subscribers registered through fcntl(F_SETFL, O_ASYNC)
+ */
+struct gpio_ctrl_file {
+    struct gpio_ctrl_dev *gdev;
+    struct list_head node;
+    u64 next_seq;
+    wait_queue_head_t wait;
+    u32 low_watermark;
+    u64 max_delay_ns;
+    struct hrtimer batch_timer;
+    struct eventfd_ctx *notify_eventfd;
+    struct fasync_struct *async_queue;
+};
 
-static dev_t dev_num;
-static struct cdev gpio_cdev;
+static dev_t dev_num;                         // First of GPIO_CTRL_MAX_MINORS device numbers
 static struct class *gpio_class = NULL;
-static struct device *gpio_device;
+static struct gpio_ctrl_dev *gpio_device;     // LED/button device, minor 0
+static DEFINE_IDA(gpio_minor_ida);            // Minors of runtime lines
 
 static DEFINE_MUTEX(gpio_mutex);              // Mutex for synchronization
-static DECLARE_WAIT_QUEUE_HEAD(wq);           // Wait queue for poll
-static bool data_ready = false;               // Flag for poll readiness
 
 // External GPIO functions implemented in separate modules
 extern void gpio_led_toggle(void);
+extern void gpio_led_toggle_quiet(void);
 extern int get_led_status(void);
 extern int get_button_status(void);
 
+/**
+ * gpio_ctrl_pending_locked - Count events a reader has not dequeued yet
+ * @ctx: Per-open state of the reader
+ *
+ * A reader that fell more than GPIO_EVENT_RING_SIZE events behind
+ * silently skips ahead to the oldest event still retained.
+ * Caller holds the device lock.
+ *
+ * Return: Number of pending events.
+ */
+static u64 gpio_ctrl_pending_locked(struct gpio_ctrl_file *ctx)
+{
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+
+    if (gdev->head - ctx->next_seq > GPIO_EVENT_RING_SIZE)
+        ctx->next_seq = gdev->head - GPIO_EVENT_RING_SIZE;
+    return gdev->head - ctx->next_seq;
+}
+
+/**
+ * gpio_ctrl_notify_locked - Deliver one batch notification to a reader
+ * @ctx: Per-open state of the reader
+ *
+ * Wakes poll waiters, signals the registered eventfd and sends SIGIO to
+ * fasync subscribers. Caller holds the device lock, which keeps
+ * @ctx->notify_eventfd alive.
+ */
+static void gpio_ctrl_notify_locked(struct gpio_ctrl_file *ctx)
+{
+    wake_up_interruptible(&ctx->wait);
+    if (ctx->notify_eventfd)
+        eventfd_signal(ctx->notify_eventfd, 1);
+    kill_fasync(&ctx->async_queue, SIGIO, POLL_IN);
+}
+
+/**
+ * gpio_ctrl_arm_batch_locked - Arm a reader's coalescing timer for its open batch
+ * @ctx: Per-open state of the reader
+ *
+ * Does nothing unless events are pending below the low watermark and a
+ * maximum delay is set. The timer is armed for when the oldest pending
+ * event reaches the delay; if that already passed (the reader was told
+ * and left events behind), it fires one delay from now so the leftovers
+ * are reported again without a notification per event.
+ * Caller holds the device lock.
+ */
+static void gpio_ctrl_arm_batch_locked(struct gpio_ctrl_file *ctx)
+{
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    u64 pending = gpio_ctrl_pending_locked(ctx);
+    u64 now, due;
+
+    if (!pending || pending >= ctx->low_watermark || !ctx->max_delay_ns)
+        return;
+
+    now = ktime_get_ns();
+    due = gdev->ring[ctx->next_seq & (GPIO_EVENT_RING_SIZE - 1)].timestamp_ns + ctx->max_delay_ns;
+    if (due <= now)
+        due = now + ctx->max_delay_ns;
+    hrtimer_start(&ctx->batch_timer, ns_to_ktime(due), HRTIMER_MODE_ABS);
+}
+
+/**
+ * gpio_ctrl_queue_event - Run the hooks on an event and queue it for readers
+ * @gdev: Device whose readers receive the event
+ * @event: Event to queue; its @seq field is assigned here
+ *
+ * May be called from hard IRQ context. eBPF programs attached to the
+ * writable gpio_ctrl_queue_event tracepoint run first and may rewrite or
+ * drop the event; the classic GPIO_SET_FILTER filter then sees the result.
+ * Dropped events do not consume a sequence number or wake readers.
+ * A reader is notified on every event once its pending count is at or
+ * above the low watermark, so an eventfd or SIGIO consumer that stops
+ * short of draining the queue is still told about new events; below the
+ * watermark, the first pending event arms its coalescing timer instead.
+ * GPIO_WAIT_EVENT callers bypass batching and are woken on every event.
+ */
+static void gpio_ctrl_queue_event(struct gpio_ctrl_dev *gdev, struct gpio_event *event)
+{
+    struct gpio_ctrl_file *ctx;
+    unsigned long flags;
+
+    if (trace_gpio_ctrl_queue_event_enabled()) {
+        struct gpio_event_hook hook = {
+            .event = *event,
+            .minor = MINOR(gdev->dev.devt),
+        };
+
+        trace_gpio_ctrl_queue_event(&hook);
+        if (hook.drop)
+            return;
+        *event = hook.event;
+    }
+
+    spin_lock_irqsave(&gdev->lock, flags);
+
+    if (gdev->filter && !BPF_PROG_RUN(gdev->filter, event)) {
+        spin_unlock_irqrestore(&gdev->lock, flags);
+        return;
+    }
+
+    event->seq = gdev->head;
+    gdev->ring[gdev->head & (GPIO_EVENT_RING_SIZE - 1)] = *event;
+    gdev->head++;
+
+    list_for_each_entry(ctx, &gdev->files, node) {
+        u64 pending = gpio_ctrl_pending_locked(ctx);
+
+        if (pending >= ctx->low_watermark) {
+            hrtimer_try_to_cancel(&ctx->batch_timer);
+            gpio_ctrl_notify_locked(ctx);
+        } else if (pending == 1 && ctx->max_delay_ns) {
+            hrtimer_start(&ctx->batch_timer,
+                          ns_to_ktime(event->timestamp_ns + ctx->max_delay_ns),
+                          HRTIMER_MODE_ABS);
+        }
+    }
+
+    spin_unlock_irqrestore(&gdev->lock, flags);
+
+    if (wq_has_sleeper(&gdev->event_wait))
+        wake_up_interruptible(&gdev->event_wait);
+}
+
+/**
+ * gpio_ctrl_dequeue_event - Take the next pending event for a reader
+ * @ctx: Per-open state of the reader
+ * @event: Output event record
+ *
+ * Re-arms the coalescing timer for the new oldest event, so a reader that
+ * takes only part of a batch is still notified about the rest.
+ *
+ * Return: 0 on success, -EAGAIN if no event is pending.
+ */
+static int gpio_ctrl_dequeue_event(struct gpio_ctrl_file *ctx, struct gpio_event *event)
+{
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    unsigned long flags;
+    int ret = 0;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+
+    if (!gpio_ctrl_pending_locked(ctx)) {
+        ret = -EAGAIN;
+    } else {
+        *event = gdev->ring[ctx->next_seq & (GPIO_EVENT_RING_SIZE - 1)];
+        ctx->next_seq++;
+        gpio_ctrl_arm_batch_locked(ctx);
+    }
+
+    spin_unlock_irqrestore(&gdev->lock, flags);
+    return ret;
+}
+
+/**
+ * gpio_ctrl_fetch_event - Copy the first event at or after a sequence number
+ * @gdev: Device to look at
+ * @seq: Wanted sequence number
+ * @event: Output event record
+ *
+ * If @seq was already overwritten, the oldest retained event is returned.
+ *
+ * Return: true if such an event has been queued.
+ */
+static bool gpio_ctrl_fetch_event(struct gpio_ctrl_dev *gdev, u64 seq, struct gpio_event *event)
+{
+    unsigned long flags;
+    bool found = false;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+
+    if (gdev->head > seq) {
+        if (gdev->head - seq > GPIO_EVENT_RING_SIZE)
+            seq = gdev->head - GPIO_EVENT_RING_SIZE;
+        *event = gdev->ring[seq & (GPIO_EVENT_RING_SIZE - 1)];
+        found = true;
+    }
+
+    spin_unlock_irqrestore(&gdev->lock, flags);
+    return found;
+}
+
+/**
+ * gpio_ctrl_events_ready - Check whether a reader's pending batch is complete
+ * @ctx: Per-open state of the reader
+ *
+ * A batch is complete when the low watermark is reached, or when the
+ * oldest pending event has waited for the maximum coalescing delay.
+ * If the batch is still open, the coalescing timer is (re)armed for the
+ * oldest pending event so a partially drained batch is not stranded.
+ *
+ * Return: true if the reader should be reported readable.
+ */
+static bool gpio_ctrl_events_ready(struct gpio_ctrl_file *ctx)
+{
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    unsigned long flags;
+    bool ready = false;
+    u64 pending, due;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+
+    pending = gpio_ctrl_pending_locked(ctx);
+    if (pending >= ctx->low_watermark) {
+        ready = true;
+    } else if (pending && ctx->max_delay_ns) {
+        due = gdev->ring[ctx->next_seq & (GPIO_EVENT_RING_SIZE - 1)].timestamp_ns +
+              ctx->max_delay_ns;
+        if (ktime_get_ns() >= due)
+            ready = true;
+        else
+            hrtimer_start(&ctx->batch_timer, ns_to_ktime(due), HRTIMER_MODE_ABS);
+    }
+
+    spin_unlock_irqrestore(&gdev->lock, flags);
+    return ready;
+}
+
+/**
+ * gpio_ctrl_batch_timeout - Coalescing timer callback
+ * @timer: The reader's batch timer
+ *
+ * Notifies the reader only if its oldest pending event has waited for the
+ * maximum delay (or the watermark was reached meanwhile); a reader that
+ * already drained its queue is left alone. The timer is re-armed for
+ * whatever is still pending below the watermark.
+ *
+ * Return: HRTIMER_NORESTART; gpio_ctrl_arm_batch_locked() re-queues the timer.
+ */
+static enum hrtimer_restart gpio_ctrl_batch_timeout(struct hrtimer *timer)
+{
+    struct gpio_ctrl_file *ctx = container_of(timer, struct gpio_ctrl_file, batch_timer);
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    unsigned long flags;
+    u64 pending, due;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+
+    pending = gpio_ctrl_pending_locked(ctx);
+    if (pending) {
+        due = gdev->ring[ctx->next_seq & (GPIO_EVENT_RING_SIZE - 1)].timestamp_ns +
+              ctx->max_delay_ns;
+        if (pending >= ctx->low_watermark || (ctx->max_delay_ns && ktime_get_ns() >= due))
+            gpio_ctrl_notify_locked(ctx);
+        gpio_ctrl_arm_batch_locked(ctx);
+    }
+
+    spin_unlock_irqrestore(&gdev->lock, flags);
+
+    return HRTIMER_NORESTART;
+}
+
+/**
+ * button_event_notify - Button notifier callback feeding the LED/button device
+ * @nb: Notifier block
+ * @action: Unused
+ * @data: Pointer to the struct gpio_event built by button_isr
+ *
+ * Runs in hard IRQ context.
+ *
+ * Return: NOTIFY_OK.
+ */
+static int button_event_notify(struct notifier_block *nb, unsigned long action, void *data)
+{
+    struct gpio_event event = *(struct gpio_event *)data;
+
+    gpio_ctrl_queue_event(gpio_device, &event);
+    return NOTIFY_OK;
+}
+
+static struct notifier_block button_event_nb = {
+    .notifier_call = button_event_notify,
+};
+
+/**
+ * gpio_ctrl_check_filter - Validate and rewrite a classic BPF event filter
+ * @filter: Filter instructions, already checked by bpf_check_classic()
+ * @flen: Number of instructions
+ *
+ * Filters run on a struct gpio_event instead of packet data. Absolute
+ * word loads are turned into loads from the event record (the same
+ * rewrite seccomp uses), and everything that only makes sense on an
+ * skb is rejected. The program's return value is the verdict:
+ * zero drops the event, non-zero queues it.
+ *
+ * Return: 0 if the filter is usable, -EINVAL otherwise.
+ */
+static int gpio_ctrl_check_filter(struct sock_filter *filter, unsigned int flen)
+{
+    unsigned int pc;
+
+    for (pc = 0; pc < flen; pc++) {
+        struct sock_filter *ftest = &filter[pc];
+
+        switch (ftest->code) {
+        case BPF_LD | BPF_W | BPF_ABS:
+            if (ftest->k >= sizeof(struct gpio_event) || ftest->k & 3)
+                return -EINVAL;
+            ftest->code = BPF_LDX | BPF_W | BPF_ABS;
+            continue;
+        case BPF_LD | BPF_W | BPF_LEN:
+            ftest->code = BPF_LD | BPF_IMM;
+            ftest->k = sizeof(struct gpio_event);
+            continue;
+        case BPF_LDX | BPF_W | BPF_LEN:
+            ftest->code = BPF_LDX | BPF_IMM;
+            ftest->k = sizeof(struct gpio_event);
+            continue;
+        case BPF_RET | BPF_K:
+        case BPF_RET | BPF_A:
+        case BPF_ALU | BPF_ADD | BPF_K:
+        case BPF_ALU | BPF_ADD | BPF_X:
+        case BPF_ALU | BPF_SUB | BPF_K:
+        case BPF_ALU | BPF_SUB | BPF_X:
+        case BPF_ALU | BPF_MUL | BPF_K:
+        case BPF_ALU | BPF_MUL | BPF_X:
+        case BPF_ALU | BPF_DIV | BPF_K:
+        case BPF_ALU | BPF_DIV | BPF_X:
+        case BPF_ALU | BPF_AND | BPF_K:
+        case BPF_ALU | BPF_AND | BPF_X:
+        case BPF_ALU | BPF_OR | BPF_K:
+        case BPF_ALU | BPF_OR | BPF_X:
+        case BPF_ALU | BPF_XOR | BPF_K:
+        case BPF_ALU | BPF_XOR | BPF_X:
+        case BPF_ALU | BPF_LSH | BPF_K:
+        case BPF_ALU | BPF_LSH | BPF_X:
+        case BPF_ALU | BPF_RSH | BPF_K:
+        case BPF_ALU | BPF_RSH | BPF_X:
+        case BPF_ALU | BPF_NEG:
+        case BPF_LD | BPF_IMM:
+        case BPF_LDX | BPF_IMM:
+        case BPF_MISC | BPF_TAX:
+        case BPF_MISC | BPF_TXA:
+        case BPF_LD | BPF_MEM:
+        case BPF_LDX | BPF_MEM:
+        case BPF_ST:
+        case BPF_STX:
+        case BPF_JMP | BPF_JA:
+        case BPF_JMP | BPF_JEQ | BPF_K:
+        case BPF_JMP | BPF_JEQ | BPF_X:
+        case BPF_JMP | BPF_JGE | BPF_K:
+        case BPF_JMP | BPF_JGE | BPF_X:
+        case BPF_JMP | BPF_JGT | BPF_K:
+        case BPF_JMP | BPF_JGT | BPF_X:
+        case BPF_JMP | BPF_JSET | BPF_K:
+        case BPF_JMP | BPF_JSET | BPF_X:
+            continue;
+        default:
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+/**
+ * gpio_ctrl_swap_filter - Replace the event filter attached to a device
+ * @gdev: Device whose events are filtered
+ * @prog: New filter, or NULL to detach
+ *
+ * Return: The previously attached filter (caller destroys it), or NULL.
+ */
+static struct bpf_prog *gpio_ctrl_swap_filter(struct gpio_ctrl_dev *gdev, struct bpf_prog *prog)
+{
+    struct bpf_prog *old;
+    unsigned long flags;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+    old = gdev->filter;
+    gdev->filter = prog;
+    spin_unlock_irqrestore(&gdev->lock, flags);
+
+    return old;
+}
+
+/**
+ * gpio_ctrl_ops_get - Pin the line operations of a device
+ * @gdev: Device to operate on
+ *
+ * Return: The operations with @gdev->ops_sem held for reading, or NULL
+ * (nothing held) if the runtime line behind @gdev was torn down.
+ */
+static const struct gpio_ctrl_ops *gpio_ctrl_ops_get(struct gpio_ctrl_dev *gdev)
+{
+    down_read(&gdev->ops_sem);
+    if (!gdev->ops) {
+        up_read(&gdev->ops_sem);
+        return NULL;
+    }
+    return gdev->ops;
+}
+
+/**
+ * gpio_ctrl_ops_put - Release operations pinned by gpio_ctrl_ops_get()
+ * @gdev: Device operated on
+ */
+static void gpio_ctrl_ops_put(struct gpio_ctrl_dev *gdev)
+{
+    up_read(&gdev->ops_sem);
+}
+
+// LED/button device: bit 1 = LED, bit 0 = button
+static int led_button_get_status(struct gpio_ctrl_dev *gdev)
+{
+    return (get_led_status() << 1) | get_button_status();
+}
+
+static int led_button_toggle(struct gpio_ctrl_dev *gdev)
+{
+    gpio_led_toggle();
+    return get_led_status();
+}
+
+static int led_button_batch_toggle(struct gpio_ctrl_dev *gdev)
+{
+    gpio_led_toggle_quiet();
+    return get_led_status();
+}
+
+static int led_button_format(struct gpio_ctrl_dev *gdev, char *buf, size_t size)
+{
+    return snprintf(buf, size, "LED: %s | Button: %s\n",
+                    get_led_status() ? "ON" : "OFF",
+                    get_button_status() ? "PRESSED" : "RELEASED");
+}
+
+static const struct gpio_ctrl_ops led_button_ops = {
+    .get_status   = led_button_get_status,
+    .toggle       = led_button_toggle,
+    .batch_toggle = led_button_batch_toggle,
+    .format       = led_button_format,
+    .toggle_event = GPIO_EVENT_LED,
+};
+
+// Runtime line device: bit 0 = logical line value.
+// Called in process context, so outputs may sit on sleeping controllers (I2C expanders).
+static int line_get_status(struct gpio_ctrl_dev *gdev)
+{
+    return gpiod_get_value_cansleep(gdev->desc);
+}
+
+static int line_toggle(struct gpio_ctrl_dev *gdev)
+{
+    int value;
+
+    if (!gdev->output)
+        return -EPERM;
+
+    value = gpiod_get_value_cansleep(gdev->desc);
+    if (value < 0)
+        return value;
+
+    value = !value;
+    gpiod_set_value_cansleep(gdev->desc, value);
+    return value;
+}
+
+static int line_format(struct gpio_ctrl_dev *gdev, char *buf, size_t size)
+{
+    int value = gpiod_get_value_cansleep(gdev->desc);
+
+    if (value < 0)
+        return value;
+    return snprintf(buf, size, "Line %s:%u (%s): %s\n", gdev->chip, gdev->offset,
+                    gdev->output ? "out" : "in", value ? "ACTIVE" : "INACTIVE");
+}
+
+static const struct gpio_ctrl_ops line_ops = {
+    .get_status   = line_get_status,
+    .toggle       = line_toggle,
+    .batch_toggle = line_toggle,
+    .format       = line_format,
+    .toggle_event = GPIO_EVENT_OUTPUT,
+};
+
+/**
+ * line_isr - Edge interrupt of a runtime input line
+ * @irq: IRQ number triggered
+ * @dev_id: The line's struct gpio_ctrl_dev
+ *
+ * Return: IRQ_HANDLED.
+ */
+static irqreturn_t line_isr(int irq, void *dev_id)
+{
+    struct gpio_ctrl_dev *gdev = dev_id;
+    struct gpio_event event = {
+        .type = GPIO_EVENT_INPUT,
+        .timestamp_ns = ktime_get_ns(),
+        .value = gpiod_get_value(gdev->desc),
+    };
+
+    gpio_ctrl_queue_event(gdev, &event);
+    return IRQ_HANDLED;
+}
+
 /**
  * gpio_ctrl_open - Open the GPIO control device
  * @inode: Pointer to inode structure
  * @file: Pointer to file structure
  *
- * Called when the device is opened from user space.
+ * Called when the device is opened from user space. The new reader
+ * only sees events queued after this point.
  *
- * Return: 0 on success.
+ * Return: 0 on success, -ENOMEM if per-file state cannot be allocated.
  */
 static int gpio_ctrl_open(struct inode *inode, struct file *file)
 {
-    pr_info("gpio_ctrl: Device opened\n");
+    struct gpio_ctrl_dev *gdev = container_of(inode->i_cdev, struct gpio_ctrl_dev, cdev);
+    struct gpio_ctrl_file *ctx;
+    unsigned long flags;
+
+    ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+    if (!ctx)
+        return -ENOMEM;
+
+    ctx->gdev = gdev;
+    init_waitqueue_head(&ctx->wait);
+    ctx->low_watermark = 1;     // Wake on every event until GPIO_SET_WAKEUP says otherwise
+    hrtimer_init(&ctx->batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+    ctx->batch_timer.function = gpio_ctrl_batch_timeout;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+    ctx->next_seq = gdev->head;
+    list_add_tail(&ctx->node, &gdev->files);
+    spin_unlock_irqrestore(&gdev->lock, flags);
+
+    file->private_data = ctx;
+
+    pr_info("gpio_ctrl: %s opened\n", dev_name(&gdev->dev));
     return 0;
 }
 
@@ -54,7 +671,19 @@ static int gpio_ctrl_open(struct inode *inode, struct file *file)
  */
 static int gpio_ctrl_release(struct inode *inode, struct file *file)
 {
-    pr_info("gpio_ctrl: Device closed\n");
+    struct gpio_ctrl_file *ctx = file->private_data;
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    unsigned long flags;
+
+    spin_lock_irqsave(&gdev->lock, flags);
+    list_del(&ctx->node);
+    spin_unlock_irqrestore(&gdev->lock, flags);
+
+    hrtimer_cancel(&ctx->batch_timer);
+    if (ctx->notify_eventfd)
+        eventfd_ctx_put(ctx->notify_eventfd);
+    kfree(ctx);
+    pr_info("gpio_ctrl: %s closed\n", dev_name(&gdev->dev));
     return 0;
 }
 
@@ -65,12 +694,15 @@ static int gpio_ctrl_release(struct inode *inode, struct file *file)
  * @count: Number of bytes written
  * @ppos: File position pointer
  *
- * Parses user command. If it is "toggle", toggles the LED and signals poll.
+ * Parses user command. If it is "toggle", toggles the LED (or output
+ * line) and queues a toggle event for poll/GPIO_READ_EVENT readers.
  *
- * Return: Number of bytes written on success, or -EFAULT/-EINVAL on error.
+ * Return: Number of bytes written on success, or -EFAULT/-EINVAL/-EPERM/-ENODEV on error.
  */
 static ssize_t gpio_ctrl_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
 {
+    struct gpio_ctrl_file *ctx = file->private_data;
+    const struct gpio_ctrl_ops *ops;
     char cmd[16] = {0};
 
     if (copy_from_user(cmd, buf, min(count, sizeof(cmd) - 1)))
@@ -79,9 +711,21 @@ static ssize_t gpio_ctrl_write(struct file *file, const char __user *buf, size_t
     pr_info("gpio_ctrl: Received write command: %s\n", cmd);
 
     if (strncmp(cmd, "toggle", 6) == 0) {
-        gpio_led_toggle();
-        data_ready = true;
-        wake_up_interruptible(&wq);
+        struct gpio_event event = {0};
+        int value;
+
+        ops = gpio_ctrl_ops_get(ctx->gdev);
+        if (!ops)
+            return -ENODEV;
+        value = ops->toggle(ctx->gdev);
+        gpio_ctrl_ops_put(ctx->gdev);
+        if (value < 0)
+            return value;
+
+        event.type = ops->toggle_event;
+        event.value = value;
+        event.timestamp_ns = ktime_get_ns();
+        gpio_ctrl_queue_event(ctx->gdev, &event);
         return count;
     }
 
@@ -90,27 +734,32 @@ static ssize_t gpio_ctrl_write(struct file *file, const char __user *buf, size_t
 }
 
 /**
- * gpio_ctrl_read - Read LED and button status as a formatted string
+ * gpio_ctrl_read - Read LED and button (or line) status as a formatted string
  * @file: File pointer
  * @buf: User-space buffer
  * @count: Number of bytes to read
  * @ppos: File position pointer
  *
- * Returns: "LED: ON | Button: PRESSED" or similar text.
+ * Returns: "LED: ON | Button: PRESSED" or similar text; runtime lines
+ * return "Line gpio-0-31:13 (in): ACTIVE".
  *
- * Return: Number of bytes read or -EFAULT if copy_to_user fails.
+ * Return: Number of bytes read, -EFAULT if copy_to_user fails,
+ * -ENODEV if the line was torn down, or the error reading the line.
  */
 static ssize_t gpio_ctrl_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
 {
-    char status[64];
+    struct gpio_ctrl_file *ctx = file->private_data;
+    const struct gpio_ctrl_ops *ops;
+    char status[96];        // Fits the longest chip label of a runtime line
     int len;
 
-    int led = get_led_status();
-    int button = get_button_status();
-
-    len = snprintf(status, sizeof(status), "LED: %s | Button: %s\n",
-                   led ? "ON" : "OFF",
-                   button ? "PRESSED" : "RELEASED");
+    ops = gpio_ctrl_ops_get(ctx->gdev);
+    if (!ops)
+        return -ENODEV;
+    len = ops->format(ctx->gdev, status, sizeof(status));
+    gpio_ctrl_ops_put(ctx->gdev);
+    if (len < 0)
+        return len;
 
     if (*ppos > 0 || count < len)
         return 0;
@@ -122,6 +771,209 @@ static ssize_t gpio_ctrl_read(struct file *file, char __user *buf, size_t count,
     return len;
 }
 
+/**
+ * gpio_ctrl_wait_event - Block for an event and return it with a status snapshot
+ * @gdev: Device to wait on
+ * @uwait: User-space struct gpio_wait_event
+ *
+ * Replaces the poll() + read()/GPIO_GET_STATUS sequence with one call.
+ * The event record is returned as queued, so a short press is reported
+ * even if the button was released before the caller ran.
+ *
+ * Return: 0 on success, -ETIMEDOUT once the deadline passed, -ERESTARTSYS
+ * on a signal, -ENODEV if the line was torn down, -EINVAL for a non-zero
+ * @reserved or a deadline beyond the ktime_t range, the error reading the
+ * line for the status snapshot, or -EFAULT.
+ */
+static long gpio_ctrl_wait_event(struct gpio_ctrl_dev *gdev, struct gpio_wait_event __user *uwait)
+{
+    const struct gpio_ctrl_ops *ops;
+    struct gpio_wait_event wait;
+    unsigned long flags;
+    ktime_t timeout = KTIME_MAX;
+    u64 seq;
+    long ret;
+
+    if (copy_from_user(&wait, uwait, sizeof(wait)))
+        return -EFAULT;
+    if (wait.reserved || wait.deadline_ns > S64_MAX)
+        return -EINVAL;
+
+    if (wait.after_seq == GPIO_WAIT_NEXT) {
+        spin_lock_irqsave(&gdev->lock, flags);
+        seq = gdev->head;
+        spin_unlock_irqrestore(&gdev->lock, flags);
+    } else {
+        seq = wait.after_seq + 1;
+    }
+
+    if (wait.deadline_ns)
+        timeout = ktime_sub(ns_to_ktime(wait.deadline_ns), ktime_get());
+
+    ret = wait_event_interruptible_hrtimeout(gdev->event_wait,
+                                             gpio_ctrl_fetch_event(gdev, seq, &wait.event) ||
+                                             !READ_ONCE(gdev->ops),
+                                             timeout);
+    if (ret == -ETIME)
+        return -ETIMEDOUT;
+    if (ret)
+        return ret;
+
+    ops = gpio_ctrl_ops_get(gdev);
+    if (!ops)
+        return -ENODEV;
+    wait.status = ops->get_status(gdev);
+    gpio_ctrl_ops_put(gdev);
+    if (wait.status < 0)
+        return wait.status;
+
+    if (copy_to_user(uwait, &wait, sizeof(wait)))
+        return -EFAULT;
+    return 0;
+}
+
+/**
+ * gpio_ctrl_batch_wait - Block until the caller has an event and dequeue it
+ * @ctx: Per-open state of the caller
+ * @deadline_ns: Absolute CLOCK_MONOTONIC deadline, 0 = wait forever
+ * @event: Output event record
+ *
+ * Backs GPIO_OP_WAIT_EVENT. Unlike GPIO_WAIT_EVENT it consumes the event
+ * from the caller's own cursor, like GPIO_OP_READ_EVENT does. Must be
+ * called without the line operations pinned, so teardown is not held off.
+ *
+ * Return: 0 on success, -ETIMEDOUT once the deadline passed, -EINTR on a
+ * signal, -ENODEV if the line was torn down, -EINVAL for a deadline beyond
+ * the ktime_t range.
+ */
+static int gpio_ctrl_batch_wait(struct gpio_ctrl_file *ctx, u64 deadline_ns, struct gpio_event *event)
+{
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    ktime_t timeout = KTIME_MAX;
+    bool found = false;
+    long ret;
+
+    if (deadline_ns > S64_MAX)
+        return -EINVAL;
+    if (deadline_ns)
+        timeout = ktime_sub(ns_to_ktime(deadline_ns), ktime_get());
+
+    ret = wait_event_interruptible_hrtimeout(gdev->event_wait,
+                                             (found = !gpio_ctrl_dequeue_event(ctx, event)) ||
+                                             !READ_ONCE(gdev->ops),
+                                             timeout);
+    if (ret == -ETIME)
+        return -ETIMEDOUT;
+    if (ret)
+        return -EINTR;      // Not restartable: earlier operations already ran
+    return found ? 0 : -ENODEV;
+}
+
+/**
+ * gpio_ctrl_batch - Execute a vector of GPIO operations in one call
+ * @ctx: Per-open state of the caller
+ * @ubatch: User-space struct gpio_batch
+ *
+ * Operations run in order, in chunks of GPIO_BATCH_MAX_OPS. A failing
+ * operation stores its negative error code in its @result and does not
+ * stop the batch, except that an interrupted GPIO_OP_WAIT_EVENT ends it.
+ * Unlike the single-shot ioctls nothing is logged per operation (toggles
+ * go through @batch_toggle), since batches are meant for high-rate
+ * control loops.
+ *
+ * The line is pinned per chunk only and released while waiting, and the
+ * caller may be rescheduled or killed between chunks, so a long batch
+ * neither hogs the CPU nor holds off line teardown. @completed tells how
+ * far a cut-short batch got.
+ *
+ * Return: 0 on success, -EFAULT if the descriptors cannot be copied,
+ * -ENOMEM if the chunk buffer cannot be allocated, -ENODEV if the line
+ * was torn down, -EINTR if a signal arrived.
+ */
+static long gpio_ctrl_batch(struct gpio_ctrl_file *ctx, struct gpio_batch __user *ubatch)
+{
+    const struct gpio_ctrl_ops *line;
+    struct gpio_op __user *uops;
+    struct gpio_batch batch;
+    struct gpio_op *ops;
+    u32 done = 0, chunk, i;
+    long ret = 0;
+    int err;
+
+    if (copy_from_user(&batch, ubatch, sizeof(batch)))
+        return -EFAULT;
+
+    uops = u64_to_user_ptr(batch.ops);
+    ops = kmalloc_array(min_t(u32, batch.count, GPIO_BATCH_MAX_OPS), sizeof(*ops), GFP_KERNEL);
+    if (!ops)
+        return -ENOMEM;
+
+    while (done < batch.count) {
+        if (fatal_signal_pending(current)) {
+            ret = -EINTR;
+            break;
+        }
+
+        chunk = min_t(u32, batch.count - done, GPIO_BATCH_MAX_OPS);
+        if (copy_from_user(ops, uops + done, chunk * sizeof(*ops))) {
+            ret = -EFAULT;
+            break;
+        }
+
+        line = gpio_ctrl_ops_get(ctx->gdev);
+        if (!line) {
+            ret = -ENODEV;
+            break;
+        }
+
+        for (i = 0; i < chunk && !ret; i++) {
+            switch (ops[i].opcode) {
+            case GPIO_OP_GET_STATUS:
+                ops[i].result = line->get_status(ctx->gdev);
+                break;
+            case GPIO_OP_TOGGLE_LED:
+                ops[i].result = min(line->batch_toggle(ctx->gdev), 0);
+                break;
+            case GPIO_OP_READ_EVENT:
+                ops[i].result = gpio_ctrl_dequeue_event(ctx, &ops[i].event);
+                break;
+            case GPIO_OP_WAIT_EVENT:
+                gpio_ctrl_ops_put(ctx->gdev);     // Never sleep with teardown held off
+                err = gpio_ctrl_batch_wait(ctx, ops[i].event.timestamp_ns, &ops[i].event);
+                ops[i].result = err;
+                if (err == -EINTR || err == -ENODEV)
+                    ret = err;
+                line = gpio_ctrl_ops_get(ctx->gdev);
+                if (!line && !ret)
+                    ret = -ENODEV;
+                break;
+            default:
+                ops[i].result = -EINVAL;
+                break;
+            }
+        }
+
+        if (line)
+            gpio_ctrl_ops_put(ctx->gdev);
+
+        // Write back what ran, including the operation that ended the batch
+        if (copy_to_user(uops + done, ops, i * sizeof(*ops))) {
+            ret = -EFAULT;
+            break;
+        }
+        done += i;
+        if (ret)
+            break;
+        cond_resched();
+    }
+
+    kfree(ops);
+
+    if (put_user(done, &ubatch->completed))
+        return -EFAULT;
+    return ret;
+}
+
 /**
  * gpio_ctrl_ioctl - Handle IOCTL commands from user space
  * @file: File pointer
@@ -129,48 +981,198 @@ static ssize_t gpio_ctrl_read(struct file *file, char __user *buf, size_t count,
  * @arg: Argument from user space
  *
  * Supported commands:
- * - GPIO_GET_STATUS: Return combined LED + Button status (bit 1 = LED, bit 0 = button)
- * - GPIO_TOGGLE_LED: Toggle the LED state
+ * - GPIO_GET_STATUS: Return combined LED + Button status (bit 1 = LED, bit 0 = button);
+ *   runtime lines return their logical value in bit 0
+ * - GPIO_TOGGLE_LED: Toggle the LED state (or the output line)
+ * - GPIO_READ_EVENT: Dequeue the next pending event (-EAGAIN if none)
+ * - GPIO_SET_FILTER: Attach a classic BPF filter run on every event before
+ *   it is queued (requires CAP_SYS_ADMIN, replaces any previous filter)
+ * - GPIO_CLEAR_FILTER: Detach the event filter
+ * - GPIO_SET_WAKEUP: Set this reader's low watermark and maximum
+ *   coalescing delay, so poll wakes once per batch instead of per event
+ * - GPIO_SET_EVENTFD: Register an eventfd signalled once per batch
+ *   (-1 unregisters it)
+ * - GPIO_BATCH: Execute a vector of status/toggle/read-event operations
+ * - GPIO_WAIT_EVENT: Block until the event after a given sequence number
+ *   or an absolute CLOCK_MONOTONIC deadline; returns the event and status
  *
- * Return: 0 on success, -EFAULT or -EINVAL on error.
+ * Return: 0 on success, negative error code on failure.
  */
 static long gpio_ctrl_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
+    struct gpio_ctrl_file *ctx = file->private_data;
+    struct gpio_ctrl_dev *gdev = ctx->gdev;
+    const struct gpio_ctrl_ops *ops;
+
     switch (cmd) {
     case GPIO_GET_STATUS: {
-        int status = (get_led_status() << 1) | get_button_status();
+        int status;
+
+        ops = gpio_ctrl_ops_get(gdev);
+        if (!ops)
+            return -ENODEV;
+        status = ops->get_status(gdev);
+        gpio_ctrl_ops_put(gdev);
+        if (status < 0)
+            return status;
+
         if (copy_to_user((int __user *)arg, &status, sizeof(status)))
             return -EFAULT;
-        pr_info("gpio_ctrl: IOCTL - returned status LED=%d, BTN=%d\n",
-                get_led_status(), get_button_status());
+        pr_info("gpio_ctrl: IOCTL - returned status 0x%x\n", status);
+        return 0;
+    }
+    case GPIO_TOGGLE_LED: {
+        int ret;
+
+        ops = gpio_ctrl_ops_get(gdev);
+        if (!ops)
+            return -ENODEV;
+        ret = ops->toggle(gdev);
+        gpio_ctrl_ops_put(gdev);
+        if (ret < 0)
+            return ret;
+        pr_info("gpio_ctrl: IOCTL - toggled %s\n", dev_name(&gdev->dev));
+        return 0;
+    }
+    case GPIO_READ_EVENT: {
+        struct gpio_event event;
+        int ret;
+
+        ret = gpio_ctrl_dequeue_event(ctx, &event);
+        if (ret)
+            return ret;
+        if (copy_to_user((void __user *)arg, &event, sizeof(event)))
+            return -EFAULT;
+        return 0;
+    }
+    case GPIO_SET_FILTER: {
+        struct sock_fprog fprog;
+        struct bpf_prog *prog, *old;
+        int ret;
+
+        if (!capable(CAP_SYS_ADMIN))
+            return -EPERM;
+        if (copy_from_user(&fprog, (void __user *)arg, sizeof(fprog)))
+            return -EFAULT;
+
+        ret = bpf_prog_create_from_user(&prog, &fprog, gpio_ctrl_check_filter, false);
+        if (ret)
+            return ret;
+
+        old = gpio_ctrl_swap_filter(gdev, prog);
+        if (old)
+            bpf_prog_destroy(old);
+        pr_info("gpio_ctrl: IOCTL - attached %u-instruction event filter\n", fprog.len);
+        return 0;
+    }
+    case GPIO_CLEAR_FILTER: {
+        struct bpf_prog *old;
+
+        if (!capable(CAP_SYS_ADMIN))
+            return -EPERM;
+
+        old = gpio_ctrl_swap_filter(gdev, NULL);
+        if (old)
+            bpf_prog_destroy(old);
+        pr_info("gpio_ctrl: IOCTL - detached event filter\n");
+        return 0;
+    }
+    case GPIO_SET_WAKEUP: {
+        struct gpio_wakeup wakeup;
+        unsigned long flags;
+
+        if (copy_from_user(&wakeup, (void __user *)arg, sizeof(wakeup)))
+            return -EFAULT;
+        if (!wakeup.low_watermark || wakeup.low_watermark > GPIO_EVENT_RING_SIZE)
+            return -EINVAL;
+
+        // Cancel outside the lock the callback takes, then re-arm under the new settings
+        hrtimer_cancel(&ctx->batch_timer);
+
+        spin_lock_irqsave(&gdev->lock, flags);
+        ctx->low_watermark = wakeup.low_watermark;
+        ctx->max_delay_ns = (u64)wakeup.max_delay_us * NSEC_PER_USEC;
+        if (gpio_ctrl_pending_locked(ctx) >= ctx->low_watermark)
+            gpio_ctrl_notify_locked(ctx);
+        else
+            gpio_ctrl_arm_batch_locked(ctx);
+        spin_unlock_irqrestore(&gdev->lock, flags);
+
+        wake_up_interruptible(&ctx->wait);    // Let poll re-evaluate under the new settings
         return 0;
     }
-    case GPIO_TOGGLE_LED:
-        gpio_led_toggle();
-        pr_info("gpio_ctrl: IOCTL - toggled LED\n");
+    case GPIO_BATCH:
+        return gpio_ctrl_batch(ctx, (struct gpio_batch __user *)arg);
+    case GPIO_WAIT_EVENT:
+        return gpio_ctrl_wait_event(gdev, (struct gpio_wait_event __user *)arg);
+    case GPIO_SET_EVENTFD: {
+        struct eventfd_ctx *efd = NULL, *old;
+        unsigned long flags;
+        int fd;
+
+        if (copy_from_user(&fd, (int __user *)arg, sizeof(fd)))
+            return -EFAULT;
+        if (fd >= 0) {
+            efd = eventfd_ctx_fdget(fd);
+            if (IS_ERR(efd))
+                return PTR_ERR(efd);
+        } else if (fd != -1) {
+            return -EINVAL;
+        }
+
+        spin_lock_irqsave(&gdev->lock, flags);
+        old = ctx->notify_eventfd;
+        ctx->notify_eventfd = efd;
+        spin_unlock_irqrestore(&gdev->lock, flags);
+
+        if (old)
+            eventfd_ctx_put(old);
         return 0;
+    }
     default:
         pr_warn("gpio_ctrl: IOCTL - invalid command\n");
         return -EINVAL;
     }
 }
 
+/**
+ * gpio_ctrl_fasync - Enable or disable SIGIO delivery for this file
+ * @fd: File descriptor
+ * @file: File pointer
+ * @on: Non-zero to subscribe, zero to unsubscribe
+ *
+ * Called on fcntl(F_SETFL, O_ASYNC) and on final close. SIGIO follows
+ * the same batching as poll wakeups.
+ *
+ * Return: Result of fasync_helper().
+ */
+static int gpio_ctrl_fasync(int fd, struct file *file, int on)
+{
+    struct gpio_ctrl_file *ctx = file->private_data;
+
+    return fasync_helper(fd, file, on, &ctx->async_queue);
+}
+
 /**
  * gpio_ctrl_poll - Support for poll/select system calls
  * @file: File pointer
  * @wait: Poll table structure
  *
- * Allows user-space processes to wait for LED toggle events.
+ * Allows user-space processes to wait for LED toggle and button events.
  *
- * Return: POLLIN | POLLRDNORM if data is ready, 0 otherwise.
+ * Return: EPOLLHUP | EPOLLERR once the runtime line was removed,
+ * POLLIN | POLLRDNORM if this reader's batch is complete (see
+ * GPIO_SET_WAKEUP), 0 otherwise.
  */
 static __poll_t gpio_ctrl_poll(struct file *file, struct poll_table_struct *wait)
 {
-    poll_wait(file, &wq, wait);
-    if (data_ready) {
-        data_ready = false;
+    struct gpio_ctrl_file *ctx = file->private_data;
+
+    poll_wait(file, &ctx->wait, wait);
+    if (!READ_ONCE(ctx->gdev->ops))
+        return EPOLLHUP | EPOLLERR;
+    if (gpio_ctrl_events_ready(ctx))
         return POLLIN | POLLRDNORM;
-    }
     return 0;
 }
 
@@ -183,13 +1185,470 @@ static const struct file_operations gpio_fops = {
     .write          = gpio_ctrl_write,
     .unlocked_ioctl = gpio_ctrl_ioctl,
     .poll           = gpio_ctrl_poll,
+    .fasync         = gpio_ctrl_fasync,
+};
+
+/**
+ * gpio_ctrl_dev_release - Free a device once its last reference is gone
+ * @dev: Embedded device of a struct gpio_ctrl_dev
+ *
+ * Open files keep the device alive through its cdev, so this runs after
+ * both teardown and the last close.
+ */
+static void gpio_ctrl_dev_release(struct device *dev)
+{
+    struct gpio_ctrl_dev *gdev = container_of(dev, struct gpio_ctrl_dev, dev);
+
+    if (gdev->filter)
+        bpf_prog_destroy(gdev->filter);
+    if (MINOR(dev->devt))
+        ida_free(&gpio_minor_ida, MINOR(dev->devt));
+    kfree(gdev);
+}
+
+/**
+ * gpio_ctrl_dev_alloc - Allocate and initialize a /dev/gpio_ctrl* device
+ * @minor: Minor number within dev_num
+ * @name: Device node name
+ *
+ * The device is not visible until cdev_device_add(). Once this returns,
+ * errors must be unwound with put_device(), which also frees @minor.
+ *
+ * Return: The new device, or NULL on allocation failure.
+ */
+static struct gpio_ctrl_dev *gpio_ctrl_dev_alloc(unsigned int minor, const char *name)
+{
+    struct gpio_ctrl_dev *gdev;
+
+    gdev = kzalloc(sizeof(*gdev), GFP_KERNEL);
+    if (!gdev)
+        return NULL;
+
+    init_rwsem(&gdev->ops_sem);
+    INIT_LIST_HEAD(&gdev->files);
+    init_waitqueue_head(&gdev->event_wait);
+    spin_lock_init(&gdev->lock);
+
+    device_initialize(&gdev->dev);
+    gdev->dev.class = gpio_class;
+    gdev->dev.devt = MKDEV(MAJOR(dev_num), minor);
+    gdev->dev.release = gpio_ctrl_dev_release;
+    dev_set_name(&gdev->dev, "%s", name);
+
+    cdev_init(&gdev->cdev, &gpio_fops);
+    gdev->cdev.owner = THIS_MODULE;
+
+    return gdev;
+}
+
+/**
+ * struct gpio_line_item - configfs item describing one runtime line
+ * @item: configfs item, created by mkdir under /sys/kernel/config/gpio_ctrl
+ * @lock: Serializes attribute writes with enable/disable
+ * @chip: Label of the gpiochip providing the line, empty until set
+ * @offset: Line offset within @chip
+ * @output: Line is requested as an output
+ * @active_low: Line is active low
+ * @gdev: Device while the line is enabled, NULL otherwise
+ */
+struct gpio_line_item {
+    struct config_item item;
+    struct mutex lock;
+    char chip[GPIO_LINE_CHIP_LEN];
+    unsigned int offset;
+    bool output;
+    bool active_low;
+    struct gpio_ctrl_dev *gdev;
+};
+
+static inline struct gpio_line_item *to_gpio_line_item(struct config_item *item)
+{
+    return container_of(item, struct gpio_line_item, item);
+}
+
+/**
+ * gpio_line_enable - Request a runtime line and create its device
+ * @line: Line description
+ *
+ * Maps the chip label and offset to the new device with a temporary
+ * lookup table and requests the line through the descriptor API, so no
+ * global GPIO numbers are involved. Hooks up an edge interrupt for
+ * inputs and registers /dev/gpio_ctrl<minor>. Other devices are not
+ * touched. Caller holds @line->lock.
+ *
+ * Return: 0 on success, -ENODEV if no such chip is registered, other
+ * negative error code on failure.
+ */
+static int gpio_line_enable(struct gpio_line_item *line)
+{
+    const char *label = config_item_name(&line->item);
+    struct gpiod_lookup_table *lookup;
+    struct gpio_ctrl_dev *gdev;
+    struct gpio_desc *desc;
+    char name[16];
+    int minor, ret;
+
+    if (!line->chip[0])
+        return -EINVAL;
+
+    minor = ida_alloc_range(&gpio_minor_ida, 1, GPIO_CTRL_MAX_MINORS - 1, GFP_KERNEL);
+    if (minor < 0)
+        return minor;
+
+    snprintf(name, sizeof(name), "%s%d", DEVICE_NAME, minor);
+    gdev = gpio_ctrl_dev_alloc(minor, name);
+    if (!gdev) {
+        ida_free(&gpio_minor_ida, minor);
+        return -ENOMEM;
+    }
+
+    lookup = kzalloc(struct_size(lookup, table, 2), GFP_KERNEL);    // Entry + terminator
+    if (!lookup) {
+        ret = -ENOMEM;
+        goto err_put;
+    }
+    lookup->dev_id = dev_name(&gdev->dev);
+    lookup->table[0] = GPIO_LOOKUP(line->chip, line->offset, NULL,
+                                   line->active_low ? GPIO_ACTIVE_LOW : GPIO_ACTIVE_HIGH);
+
+    // The mapping is only needed while the line is looked up
+    gpiod_add_lookup_table(lookup);
+    desc = gpiod_get(&gdev->dev, NULL, line->output ? GPIOD_OUT_LOW : GPIOD_IN);
+    gpiod_remove_lookup_table(lookup);
+    kfree(lookup);
+
+    if (IS_ERR(desc)) {
+        ret = PTR_ERR(desc);
+        if (ret == -EPROBE_DEFER)
+            ret = -ENODEV;      // No chip with that label is registered
+        pr_err("gpio_ctrl: Failed to request %s:%u for %s\n", line->chip, line->offset, label);
+        goto err_put;
+    }
+
+    strscpy(gdev->chip, line->chip, sizeof(gdev->chip));
+    gdev->offset = line->offset;
+    gdev->output = line->output;
+    gdev->desc = desc;
+
+    ret = gpiod_set_consumer_name(desc, label);
+    if (ret)
+        goto err_gpio;
+
+    if (!gdev->output) {
+        // Events are queued from hard IRQ context
+        if (gpiod_cansleep(gdev->desc)) {
+            ret = -EINVAL;
+            goto err_gpio;
+        }
+
+        ret = gpiod_to_irq(gdev->desc);
+        if (ret < 0)
+            goto err_gpio;
+        gdev->irq = ret;
+
+        ret = request_irq(gdev->irq, line_isr,
+                          IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
+                          label, gdev);
+        if (ret) {
+            gdev->irq = 0;
+            goto err_gpio;
+        }
+    }
+
+    gdev->ops = &line_ops;
+
+    ret = cdev_device_add(&gdev->cdev, &gdev->dev);
+    if (ret)
+        goto err_irq;
+
+    line->gdev = gdev;
+    pr_info("gpio_ctrl: %s -> %s:%u (%s)\n", name, line->chip, line->offset,
+            line->output ? "out" : "in");
+    return 0;
+
+err_irq:
+    if (gdev->irq)
+        free_irq(gdev->irq, gdev);
+err_gpio:
+    gpiod_put(gdev->desc);
+err_put:
+    put_device(&gdev->dev);
+    return ret;
+}
+
+/**
+ * gpio_line_disable - Remove a runtime line's device and release the line
+ * @line: Line description
+ *
+ * Files still open on the device stay valid but their line operations
+ * fail with -ENODEV and poll reports a hangup; every reader is notified
+ * once so it notices. The device is freed after the last close.
+ * Caller holds @line->lock.
+ */
+static void gpio_line_disable(struct gpio_line_item *line)
+{
+    struct gpio_ctrl_dev *gdev = line->gdev;
+    struct gpio_ctrl_file *ctx;
+    unsigned long flags;
+
+    cdev_device_del(&gdev->cdev, &gdev->dev);
+    if (gdev->irq)
+        free_irq(gdev->irq, gdev);
+
+    down_write(&gdev->ops_sem);
+    gdev->ops = NULL;
+    up_write(&gdev->ops_sem);
+    wake_up_interruptible_all(&gdev->event_wait);   // GPIO_WAIT_EVENT callers get -ENODEV
+
+    spin_lock_irqsave(&gdev->lock, flags);
+    list_for_each_entry(ctx, &gdev->files, node)
+        gpio_ctrl_notify_locked(ctx);               // poll, eventfd and SIGIO readers see the hangup
+    spin_unlock_irqrestore(&gdev->lock, flags);
+
+    gpiod_put(gdev->desc);
+    pr_info("gpio_ctrl: %s removed\n", dev_name(&gdev->dev));
+
+    put_device(&gdev->dev);
+    line->gdev = NULL;
+}
+
+static ssize_t gpio_line_chip_show(struct config_item *item, char *page)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    ssize_t len;
+
+    mutex_lock(&line->lock);
+    len = sprintf(page, "%s\n", line->chip);
+    mutex_unlock(&line->lock);
+
+    return len;
+}
+
+static ssize_t gpio_line_chip_store(struct config_item *item, const char *page, size_t count)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    size_t len = strcspn(page, "\n");
+    int ret = 0;
+
+    if (!len || len >= GPIO_LINE_CHIP_LEN)
+        return -EINVAL;
+
+    mutex_lock(&line->lock);
+    if (line->gdev) {
+        ret = -EBUSY;
+    } else {
+        memcpy(line->chip, page, len);
+        line->chip[len] = '\0';
+    }
+    mutex_unlock(&line->lock);
+
+    return ret ? ret : count;
+}
+
+static ssize_t gpio_line_offset_show(struct config_item *item, char *page)
+{
+    return sprintf(page, "%u\n", to_gpio_line_item(item)->offset);
+}
+
+static ssize_t gpio_line_offset_store(struct config_item *item, const char *page, size_t count)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    u16 offset;             // Lookup tables hold 16-bit hardware numbers
+    int ret;
+
+    ret = kstrtou16(page, 0, &offset);
+    if (ret)
+        return ret;
+
+    mutex_lock(&line->lock);
+    if (line->gdev)
+        ret = -EBUSY;
+    else
+        line->offset = offset;
+    mutex_unlock(&line->lock);
+
+    return ret ? ret : count;
+}
+
+static ssize_t gpio_line_direction_show(struct config_item *item, char *page)
+{
+    return sprintf(page, "%s\n", to_gpio_line_item(item)->output ? "out" : "in");
+}
+
+static ssize_t gpio_line_direction_store(struct config_item *item, const char *page, size_t count)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    bool output;
+    int ret = 0;
+
+    if (sysfs_streq(page, "out"))
+        output = true;
+    else if (sysfs_streq(page, "in"))
+        output = false;
+    else
+        return -EINVAL;
+
+    mutex_lock(&line->lock);
+    if (line->gdev)
+        ret = -EBUSY;
+    else
+        line->output = output;
+    mutex_unlock(&line->lock);
+
+    return ret ? ret : count;
+}
+
+static ssize_t gpio_line_active_low_show(struct config_item *item, char *page)
+{
+    return sprintf(page, "%d\n", to_gpio_line_item(item)->active_low);
+}
+
+static ssize_t gpio_line_active_low_store(struct config_item *item, const char *page, size_t count)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    bool active_low;
+    int ret;
+
+    ret = kstrtobool(page, &active_low);
+    if (ret)
+        return ret;
+
+    mutex_lock(&line->lock);
+    if (line->gdev)
+        ret = -EBUSY;
+    else
+        line->active_low = active_low;
+    mutex_unlock(&line->lock);
+
+    return ret ? ret : count;
+}
+
+static ssize_t gpio_line_enable_show(struct config_item *item, char *page)
+{
+    return sprintf(page, "%d\n", to_gpio_line_item(item)->gdev != NULL);
+}
+
+static ssize_t gpio_line_enable_store(struct config_item *item, const char *page, size_t count)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    bool enable;
+    int ret;
+
+    ret = kstrtobool(page, &enable);
+    if (ret)
+        return ret;
+
+    mutex_lock(&line->lock);
+    if (enable && !line->gdev)
+        ret = gpio_line_enable(line);
+    else if (!enable && line->gdev)
+        gpio_line_disable(line);
+    mutex_unlock(&line->lock);
+
+    return ret ? ret : count;
+}
+
+static ssize_t gpio_line_device_show(struct config_item *item, char *page)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+    ssize_t len;
+
+    mutex_lock(&line->lock);
+    len = sprintf(page, "%s\n", line->gdev ? dev_name(&line->gdev->dev) : "");
+    mutex_unlock(&line->lock);
+
+    return len;
+}
+
+CONFIGFS_ATTR(gpio_line_, chip);
+CONFIGFS_ATTR(gpio_line_, offset);
+CONFIGFS_ATTR(gpio_line_, direction);
+CONFIGFS_ATTR(gpio_line_, active_low);
+CONFIGFS_ATTR(gpio_line_, enable);
+CONFIGFS_ATTR_RO(gpio_line_, device);
+
+static struct configfs_attribute *gpio_line_attrs[] = {
+    &gpio_line_attr_chip,
+    &gpio_line_attr_offset,
+    &gpio_line_attr_direction,
+    &gpio_line_attr_active_low,
+    &gpio_line_attr_enable,
+    &gpio_line_attr_device,
+    NULL,
+};
+
+/**
+ * gpio_line_release - Free a line item on rmdir, tearing down its device
+ * @item: configfs item of the line
+ */
+static void gpio_line_release(struct config_item *item)
+{
+    struct gpio_line_item *line = to_gpio_line_item(item);
+
+    mutex_lock(&line->lock);
+    if (line->gdev)
+        gpio_line_disable(line);
+    mutex_unlock(&line->lock);
+
+    kfree(line);
+}
+
+static struct configfs_item_operations gpio_line_item_ops = {
+    .release = gpio_line_release,
+};
+
+static const struct config_item_type gpio_line_type = {
+    .ct_item_ops = &gpio_line_item_ops,
+    .ct_attrs    = gpio_line_attrs,
+    .ct_owner    = THIS_MODULE,
+};
+
+/**
+ * gpio_lines_make_item - mkdir handler creating a new, disabled line item
+ * @group: The gpio_ctrl configfs group
+ * @name: Directory name, also used as the GPIO and IRQ label
+ *
+ * Return: The new item, or ERR_PTR(-ENOMEM).
+ */
+static struct config_item *gpio_lines_make_item(struct config_group *group, const char *name)
+{
+    struct gpio_line_item *line;
+
+    line = kzalloc(sizeof(*line), GFP_KERNEL);
+    if (!line)
+        return ERR_PTR(-ENOMEM);
+
+    mutex_init(&line->lock);
+    config_item_init_type_name(&line->item, name, &gpio_line_type);
+
+    return &line->item;
+}
+
+static struct configfs_group_operations gpio_lines_group_ops = {
+    .make_item = gpio_lines_make_item,
+};
+
+static const struct config_item_type gpio_lines_type = {
+    .ct_group_ops = &gpio_lines_group_ops,
+    .ct_owner     = THIS_MODULE,
+};
+
+// configfs root: /sys/kernel/config/gpio_ctrl/<line>/{chip,offset,direction,active_low,enable,device}
+static struct configfs_subsystem gpio_lines_subsys = {
+    .su_group = {
+        .cg_item = {
+            .ci_namebuf = DEVICE_NAME,
+            .ci_type    = &gpio_lines_type,
+        },
+    },
 };
 
 /**
  * gpio_ctrl_init - Module initialization function
  *
- * Allocates a character device number, initializes and registers
- * the char device, creates sysfs class and device file.
+ * Allocates the character device numbers, creates the sysfs class,
+ * registers the LED/button device as minor 0, and registers the
+ * configfs subsystem used to provision further lines at runtime.
  *
  * Return: 0 on success, or negative error code on failure.
  */
@@ -197,41 +1656,61 @@ static int __init gpio_ctrl_init(void)
 {
     int ret;
 
-    ret = alloc_chrdev_region(&dev_num, 0, 1, DEVICE_NAME);
+    ret = alloc_chrdev_region(&dev_num, 0, GPIO_CTRL_MAX_MINORS, DEVICE_NAME);
     if (ret) {
         pr_err("gpio_ctrl: Failed to allocate chrdev region\n");
         return ret;
     }
 
-    cdev_init(&gpio_cdev, &gpio_fops);
-    gpio_cdev.owner = THIS_MODULE;
-
-    ret = cdev_add(&gpio_cdev, dev_num, 1);
-    if (ret) {
-        pr_err("gpio_ctrl: Failed to add cdev\n");
-        unregister_chrdev_region(dev_num, 1);
-        return ret;
-    }
-
     gpio_class = class_create(THIS_MODULE, CLASS_NAME);
     if (IS_ERR(gpio_class)) {
         pr_err("gpio_ctrl: Failed to create class\n");
-        cdev_del(&gpio_cdev);
-        unregister_chrdev_region(dev_num, 1);
+        unregister_chrdev_region(dev_num, GPIO_CTRL_MAX_MINORS);
         return PTR_ERR(gpio_class);
     }
 
-    gpio_device = device_create(gpio_class, NULL, dev_num, NULL, DEVICE_NAME);
-    if (IS_ERR(gpio_device)) {
+    gpio_device = gpio_ctrl_dev_alloc(0, DEVICE_NAME);
+    if (!gpio_device) {
+        class_destroy(gpio_class);
+        unregister_chrdev_region(dev_num, GPIO_CTRL_MAX_MINORS);
+        return -ENOMEM;
+    }
+    gpio_device->ops = &led_button_ops;
+
+    ret = cdev_device_add(&gpio_device->cdev, &gpio_device->dev);
+    if (ret) {
         pr_err("gpio_ctrl: Failed to create device\n");
+        put_device(&gpio_device->dev);
         class_destroy(gpio_class);
-        cdev_del(&gpio_cdev);
-        unregister_chrdev_region(dev_num, 1);
-        return PTR_ERR(gpio_device);
+        unregister_chrdev_region(dev_num, GPIO_CTRL_MAX_MINORS);
+        return ret;
     }
 
     mutex_init(&gpio_mutex);
 
+    ret = register_button_notifier(&button_event_nb);
+    if (ret) {
+        pr_err("gpio_ctrl: Failed to register button notifier\n");
+        cdev_device_del(&gpio_device->cdev, &gpio_device->dev);
+        put_device(&gpio_device->dev);
+        class_destroy(gpio_class);
+        unregister_chrdev_region(dev_num, GPIO_CTRL_MAX_MINORS);
+        return ret;
+    }
+
+    config_group_init(&gpio_lines_subsys.su_group);
+    mutex_init(&gpio_lines_subsys.su_mutex);
+    ret = configfs_register_subsystem(&gpio_lines_subsys);
+    if (ret) {
+        pr_err("gpio_ctrl: Failed to register configfs subsystem\n");
+        unregister_button_notifier(&button_event_nb);
+        cdev_device_del(&gpio_device->cdev, &gpio_device->dev);
+        put_device(&gpio_device->dev);
+        class_destroy(gpio_class);
+        unregister_chrdev_region(dev_num, GPIO_CTRL_MAX_MINORS);
+        return ret;
+    }
+
     pr_info("gpio_ctrl: Registered with major %d\n", MAJOR(dev_num));
     pr_info("gpio_ctrl: Device initialized successfully\n");
 
@@ -241,15 +1720,21 @@ static int __init gpio_ctrl_init(void)
 /**
  * gpio_ctrl_exit - Module exit function
  *
- * Cleans up the character device, class, and device file.
+ * Cleans up the configfs subsystem, character devices, class, and
+ * device numbers. configfs holds a module reference per line item, so
+ * no runtime lines remain at this point.
  * Releases allocated resources and logs the unload event.
  */
 static void __exit gpio_ctrl_exit(void)
 {
-    device_destroy(gpio_class, dev_num);
+    configfs_unregister_subsystem(&gpio_lines_subsys);
+    unregister_button_notifier(&button_event_nb);
+
+    cdev_device_del(&gpio_device->cdev, &gpio_device->dev);
+    put_device(&gpio_device->dev);      // Also destroys any attached filter
+
     class_destroy(gpio_class);
-    cdev_del(&gpio_cdev);
-    unregister_chrdev_region(dev_num, 1);
+    unregister_chrdev_region(dev_num, GPIO_CTRL_MAX_MINORS);
     pr_info("gpio_ctrl: Module unloaded\n");
 }
 
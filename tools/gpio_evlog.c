@@ -0,0 +1,345 @@
+/*
+ * gpio_evlog - Record /dev/gpio_ctrl events and replay them through a simulated GPIO line
+ *
+ * Usage:
+ *   gpio_evlog record [-d DEVICE] [-n COUNT] FILE
+ *   gpio_evlog replay [-x SPEED] FILE LINE_ATTR
+ *
+ * record dequeues events from the GPIO control device and stores them in a
+ * compact binary log until COUNT events were captured or SIGINT arrives.
+ * Events the driver overwrote before they were read (a gap in the event
+ * sequence numbers) are logged as a gap marker and make record exit with 1.
+ *
+ * replay re-creates the recorded button edges at their original spacing
+ * (or SPEED times faster) by driving a simulated line:
+ *   - gpio-sim:     LINE_ATTR = .../gpiochipN/sim_gpioM/pull   ("pull-up"/"pull-down")
+ *   - gpio-mockup:  LINE_ATTR = /sys/kernel/debug/gpio-mockup/gpiochipN/M   ("1"/"0")
+ * The button is active low, so a press drives the line low (falling edge).
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "gpio_ctrl.h"
+
+#define EVLOG_MAGIC      "GPEV"
+#define EVLOG_VERSION    1
+#define READ_BATCH_OPS   32     // Events dequeued per GPIO_BATCH call while recording
+#define EVLOG_TYPE_GAP   0xff   // Record type of a gap marker, see struct evlog_record
+
+/**
+ * struct evlog_header - File header of an event log
+ * @magic: EVLOG_MAGIC
+ * @version: EVLOG_VERSION
+ * @record_size: sizeof(struct evlog_record), for forward compatibility
+ * @start_ns: CLOCK_MONOTONIC timestamp of the first recorded event
+ */
+struct evlog_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t start_ns;
+};
+
+/**
+ * struct evlog_record - One recorded event
+ * @delta_us: Time since the previous event (saturates at ~71 minutes)
+ * @type: GPIO_EVENT_* type, or EVLOG_TYPE_GAP before the first event
+ *        recorded after events were lost
+ * @value: Logical line value sampled by the driver
+ * @lost: EVLOG_TYPE_GAP only: number of lost events (saturates), else zero
+ */
+struct evlog_record {
+    uint32_t delta_us;
+    uint8_t type;
+    uint8_t value;
+    uint16_t lost;
+};
+
+static volatile sig_atomic_t stop;
+
+static void on_sigint(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: gpio_evlog record [-d DEVICE] [-n COUNT] FILE\n"
+            "       gpio_evlog replay [-x SPEED] FILE LINE_ATTR\n");
+    exit(2);
+}
+
+/**
+ * record - Capture events from the control device into a log file
+ *
+ * Return: 0 on success, 1 on error.
+ */
+static int record(const char *device, unsigned long limit, const char *path)
+{
+    struct gpio_op ops[READ_BATCH_OPS];
+    struct evlog_header hdr = { .magic = EVLOG_MAGIC, .version = EVLOG_VERSION,
+                                .record_size = sizeof(struct evlog_record) };
+    struct gpio_batch batch = { .ops = (uintptr_t)ops, .count = READ_BATCH_OPS };
+    struct pollfd pfd;
+    unsigned long captured = 0, lost = 0;
+    uint64_t last_us = 0, next_seq = 0;
+    int fd, i, ret = 0;
+    FILE *out;
+
+    fd = open(device, O_RDONLY);
+    if (fd < 0) {
+        perror(device);
+        return 1;
+    }
+    out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        close(fd);
+        return 1;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) {   // Rewritten with start_ns at the end
+        perror(path);
+        fclose(out);
+        close(fd);
+        return 1;
+    }
+
+    signal(SIGINT, on_sigint);
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    while (!stop && (!limit || captured < limit)) {
+        if (poll(&pfd, 1, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            ret = 1;
+            break;
+        }
+
+        for (i = 0; i < READ_BATCH_OPS; i++)
+            ops[i].opcode = GPIO_OP_READ_EVENT;
+        if (ioctl(fd, GPIO_BATCH, &batch) < 0) {
+            perror("GPIO_BATCH");
+            ret = 1;
+            break;
+        }
+
+        for (i = 0; i < (int)batch.completed && ops[i].result == 0; i++) {
+            struct evlog_record rec = { .type = ops[i].event.type,
+                                        .value = ops[i].event.value };
+            uint64_t delta, now_us = ops[i].event.timestamp_ns / 1000;
+
+            if (!captured) {
+                hdr.start_ns = ops[i].event.timestamp_ns;
+                last_us = now_us;
+            } else if (ops[i].event.seq != next_seq) {
+                struct evlog_record gap = { .type = EVLOG_TYPE_GAP };
+                uint64_t missed = ops[i].event.seq - next_seq;
+
+                fprintf(stderr, "gpio_evlog: %llu events lost to ring overrun before seq %llu\n",
+                        (unsigned long long)missed, (unsigned long long)ops[i].event.seq);
+                gap.lost = missed > UINT16_MAX ? UINT16_MAX : (uint16_t)missed;
+                lost += missed;
+                if (fwrite(&gap, sizeof(gap), 1, out) != 1) {
+                    perror(path);
+                    ret = 1;
+                    break;
+                }
+            }
+            next_seq = ops[i].event.seq + 1;
+
+            // Difference of truncated timestamps, so rounding does not accumulate
+            delta = now_us - last_us;
+            rec.delta_us = delta > UINT32_MAX ? UINT32_MAX : (uint32_t)delta;
+            last_us = now_us;
+
+            if (fwrite(&rec, sizeof(rec), 1, out) != 1) {
+                perror(path);
+                ret = 1;
+                break;
+            }
+            if (++captured == limit)
+                break;
+        }
+        if (ret)
+            break;
+    }
+
+    // Keep whatever was captured readable even if recording failed
+    rewind(out);
+    if (fwrite(&hdr, sizeof(hdr), 1, out) != 1) {
+        perror(path);
+        ret = 1;
+    }
+    if (fclose(out)) {
+        perror(path);
+        ret = 1;
+    }
+    close(fd);
+
+    fprintf(stderr, "gpio_evlog: recorded %lu events\n", captured);
+    if (lost) {
+        fprintf(stderr, "gpio_evlog: %lu events lost, replay timing is incomplete\n", lost);
+        ret = 1;
+    }
+    return ret;
+}
+
+/**
+ * set_line - Drive the simulated button line
+ * @fd: Open line attribute
+ * @gpio_sim: Attribute is a gpio-sim "pull" file rather than gpio-mockup
+ * @high: Physical level to apply
+ */
+static void set_line(int fd, int gpio_sim, int high)
+{
+    const char *val;
+
+    if (gpio_sim)
+        val = high ? "pull-up" : "pull-down";
+    else
+        val = high ? "1" : "0";
+
+    if (pwrite(fd, val, strlen(val), 0) < 0)
+        perror("line write");
+}
+
+static void timespec_add_ns(struct timespec *ts, uint64_t ns)
+{
+    ns += ts->tv_nsec;
+    ts->tv_sec += ns / 1000000000ULL;
+    ts->tv_nsec = ns % 1000000000ULL;
+}
+
+/**
+ * replay - Re-create recorded button edges on a simulated line
+ *
+ * Each button event becomes a falling edge at its recorded offset divided
+ * by @speed. If the driver saw the button already released when it
+ * sampled the edge (a bounce), the line is released right away too.
+ *
+ * Return: 0 on success, 1 on error.
+ */
+static int replay(const char *path, const char *line_attr, double speed)
+{
+    struct evlog_header hdr;
+    struct evlog_record rec;
+    struct timespec next;
+    unsigned long replayed = 0, lost = 0;
+    int fd, gpio_sim, low = 0;
+    size_t len;
+    FILE *in;
+
+    in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, in) != 1 || memcmp(hdr.magic, EVLOG_MAGIC, 4) ||
+        hdr.version != EVLOG_VERSION || hdr.record_size != sizeof(rec)) {
+        fprintf(stderr, "%s: not a gpio_evlog v%d file\n", path, EVLOG_VERSION);
+        fclose(in);
+        return 1;
+    }
+
+    fd = open(line_attr, O_WRONLY);
+    if (fd < 0) {
+        perror(line_attr);
+        fclose(in);
+        return 1;
+    }
+    len = strlen(line_attr);
+    gpio_sim = len >= 5 && !strcmp(line_attr + len - 5, "/pull");
+
+    set_line(fd, gpio_sim, 1);              // Start released
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        timespec_add_ns(&next, (uint64_t)(rec.delta_us * 1000.0 / speed));
+        if (rec.type == EVLOG_TYPE_GAP)
+            lost += rec.lost;
+        if (rec.type != GPIO_EVENT_BUTTON)
+            continue;
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+
+        if (low)
+            set_line(fd, gpio_sim, 1);      // Release first so the press is a fresh edge
+        set_line(fd, gpio_sim, 0);
+        low = rec.value;
+        if (!low)
+            set_line(fd, gpio_sim, 1);
+        replayed++;
+    }
+
+    set_line(fd, gpio_sim, 1);
+    close(fd);
+    fclose(in);
+
+    fprintf(stderr, "gpio_evlog: replayed %lu button edges\n", replayed);
+    if (lost)
+        fprintf(stderr, "gpio_evlog: log is missing %lu events lost while recording\n", lost);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = "/dev/gpio_ctrl";
+    unsigned long limit = 0;
+    double speed = 1.0;
+    int opt;
+
+    if (argc < 2)
+        usage();
+
+    if (!strcmp(argv[1], "record")) {
+        optind = 2;
+        while ((opt = getopt(argc, argv, "d:n:")) != -1) {
+            switch (opt) {
+            case 'd':
+                device = optarg;
+                break;
+            case 'n':
+                limit = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage();
+            }
+        }
+        if (optind != argc - 1)
+            usage();
+        return record(device, limit, argv[optind]);
+    }
+
+    if (!strcmp(argv[1], "replay")) {
+        optind = 2;
+        while ((opt = getopt(argc, argv, "x:")) != -1) {
+            switch (opt) {
+            case 'x':
+                speed = strtod(optarg, NULL);
+                break;
+            default:
+                usage();
+            }
+        }
+        if (optind != argc - 2 || speed <= 0)
+            usage();
+        return replay(argv[optind], argv[optind + 1], speed);
+    }
+
+    usage();
+    return 2;
+}